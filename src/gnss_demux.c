@@ -0,0 +1,135 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "gnss_demux.h"
+
+LOG_MODULE_REGISTER(gnss_demux, CONFIG_LOG_DEFAULT_LEVEL);
+
+struct demux_frame
+{
+    uint8_t *data;
+    uint16_t len;
+};
+
+// Frames are allocated at their exact length once the header is in
+K_HEAP_DEFINE(demux_heap, CONFIG_LC29H_DEMUX_BUF_SIZE);
+K_MSGQ_DEFINE(demux_queue, sizeof(struct demux_frame), CONFIG_LC29H_DEMUX_FRAMES, 4);
+
+// Guards the handler and the statistics, which the shell reads from its own thread
+static struct k_spinlock demux_lock;
+static gnss_demux_rtcm_cb demux_cb;
+static void *demux_user_data;
+static struct gnss_demux_stats demux_stats;
+
+void gnss_demux_set_rtcm_handler(gnss_demux_rtcm_cb cb, void *user_data)
+{
+    k_spinlock_key_t key = k_spin_lock(&demux_lock);
+
+    demux_cb = cb;
+    demux_user_data = user_data;
+    k_spin_unlock(&demux_lock, key);
+}
+
+uint8_t *gnss_demux_rtcm_alloc(uint16_t len)
+{
+    uint8_t *frame = NULL;
+
+    // Only the parser queues, so a free slot now is still free at the end of the frame
+    if (k_msgq_num_free_get(&demux_queue) > 0)
+    {
+        frame = k_heap_alloc(&demux_heap, len, K_NO_WAIT);
+    }
+    return frame;
+}
+
+void gnss_demux_rtcm_free(uint8_t *frame)
+{
+    k_heap_free(&demux_heap, frame);
+}
+
+void gnss_demux_rtcm_frame(uint8_t *frame, uint16_t len)
+{
+    struct demux_frame item = { frame, len };
+    k_spinlock_key_t key;
+    uint32_t queued;
+
+    if (frame == NULL)
+    {
+        key = k_spin_lock(&demux_lock);
+        demux_stats.dropped++;
+        k_spin_unlock(&demux_lock, key);
+        return;
+    }
+
+    // Cannot fail, see gnss_demux_rtcm_alloc()
+    k_msgq_put(&demux_queue, &item, K_NO_WAIT);
+    queued = k_msgq_num_used_get(&demux_queue);
+
+    key = k_spin_lock(&demux_lock);
+    demux_stats.frames++;
+    demux_stats.bytes += len;
+    demux_stats.queued_max = MAX(demux_stats.queued_max, queued);
+    k_spin_unlock(&demux_lock, key);
+}
+
+void gnss_demux_rtcm_false(bool crc_error, uint16_t rescanned, uint16_t lost)
+{
+    k_spinlock_key_t key = k_spin_lock(&demux_lock);
+
+    if (crc_error)
+    {
+        demux_stats.crc_errors++;
+    }
+    else
+    {
+        demux_stats.false_preambles++;
+    }
+    demux_stats.rescanned += rescanned;
+    demux_stats.lost += lost;
+    k_spin_unlock(&demux_lock, key);
+}
+
+static void demux_thread_fn(void *p1, void *p2, void *p3)
+{
+    struct demux_frame item;
+
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    while (true)
+    {
+        gnss_demux_rtcm_cb cb;
+        void *user_data;
+        k_spinlock_key_t key;
+
+        k_msgq_get(&demux_queue, &item, K_FOREVER);
+
+        key = k_spin_lock(&demux_lock);
+        cb = demux_cb;
+        user_data = demux_user_data;
+        k_spin_unlock(&demux_lock, key);
+
+        if (cb != NULL)
+        {
+            cb(item.data, item.len, user_data);
+        }
+        k_heap_free(&demux_heap, item.data);
+    }
+}
+
+K_THREAD_DEFINE(gnss_rtcm, CONFIG_LC29H_DEMUX_STACK_SIZE, demux_thread_fn, NULL, NULL, NULL,
+                CONFIG_LC29H_DEMUX_PRIORITY, 0, 0);
+
+void gnss_demux_stats_get(struct gnss_demux_stats *stats, bool reset)
+{
+    k_spinlock_key_t key = k_spin_lock(&demux_lock);
+
+    *stats = demux_stats;
+    if (reset)
+    {
+        memset(&demux_stats, 0, sizeof(demux_stats));
+        demux_stats.since = k_uptime_get();
+    }
+    k_spin_unlock(&demux_lock, key);
+}
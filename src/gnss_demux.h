@@ -0,0 +1,49 @@
+#ifndef _GNSS_DEMUX_H_
+#define _GNSS_DEMUX_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef CONFIG_LC29H_DEMUX
+/* RTCM3 frames received between NMEA sentences (see CONFIG_LC29H_DEMUX).
+ * The framer copies each frame into a heap buffer and queues it; the
+ * "gnss_rtcm" thread hands it to the handler and frees it, so neither
+ * side waits for the other. */
+
+// From the gnss_rtcm thread: a whole frame, preamble to CRC, CRC checked
+typedef void (*gnss_demux_rtcm_cb)(const uint8_t *frame, size_t len, void *user_data);
+
+struct gnss_demux_stats
+{
+    int64_t since;           // Uptime (ms) of the last reset
+    uint32_t frames;         // Frames queued for the handler
+    uint32_t bytes;          // Bytes of those frames
+    uint32_t false_preambles;  // 0xD3 without a plausible header after it
+    uint32_t crc_errors;     // Frames failing the CRC-24Q
+    uint32_t rescanned;      // Bytes of both scanned again for NMEA
+    uint32_t lost;           // Bytes of both not kept for rescanning
+    uint32_t dropped;        // Good frames without room in the heap or queue
+    uint32_t queued_max;     // Most frames waiting for the handler
+};
+
+// Frames received before a handler is set are counted and freed
+void gnss_demux_set_rtcm_handler(gnss_demux_rtcm_cb cb, void *user_data);
+
+void gnss_demux_stats_get(struct gnss_demux_stats *stats, bool reset);
+
+// Parser: buffer for a frame of len bytes, NULL if there is no room
+uint8_t *gnss_demux_rtcm_alloc(uint16_t len);
+
+// Parser: frame passed its CRC; queued, or counted dropped if frame is NULL
+void gnss_demux_rtcm_frame(uint8_t *frame, uint16_t len);
+
+// Parser: a preamble started no valid frame; the bytes after it were
+// rescanned, but for lost ones received without heap room
+void gnss_demux_rtcm_false(bool crc_error, uint16_t rescanned, uint16_t lost);
+
+// Parser: buffer of a false frame, or of a frame cut short
+void gnss_demux_rtcm_free(uint8_t *frame);
+#endif
+
+#endif
@@ -0,0 +1,223 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "nmea.h"
+#include "nmea_cmd.h"
+#include "lc29h_config.h"
+#include "gnss_governor.h"
+
+LOG_MODULE_REGISTER(gnss_governor, CONFIG_LOG_DEFAULT_LEVEL);
+
+#define GOVERNOR_BODY_LEN 16
+
+// Sentence and rate set by each level, GNSS_GOVERNOR_LEVELS - 1 of them
+static const struct
+{
+    enum lc29h_sentence sentence;
+    uint8_t rate;
+} governor_steps[] =
+{
+    { LC29H_GSV, CONFIG_LC29H_GOVERNOR_DIVIDER },
+    { LC29H_GSA, CONFIG_LC29H_GOVERNOR_DIVIDER },
+    { LC29H_GSV, 0 },
+    { LC29H_GSA, 0 },
+};
+
+BUILD_ASSERT(ARRAY_SIZE(governor_steps) == GNSS_GOVERNOR_LEVELS - 1);
+
+// Governed sentences, index into the arrays below
+static const enum lc29h_sentence governor_sentences[] = { LC29H_GSV, LC29H_GSA };
+#define GOVERNED ARRAY_SIZE(governor_sentences)
+
+// Updated from the receive interrupt and the parser
+static struct
+{
+    struct k_spinlock lock;
+    uint32_t peak;
+    uint32_t lost;           // Bytes
+    uint32_t queued_at;      // Cycle stamp, valid while queued
+    bool queued;
+    uint32_t lag_max;        // Cycles
+} window;
+
+static struct
+{
+    uint32_t capacity;
+    uint8_t level;
+    uint8_t calm;            // Quiet periods in a row
+    uint8_t base[GOVERNED];  // Profile rates
+    uint8_t sent[GOVERNED];  // Rates the receiver acknowledged
+    uint8_t want[GOVERNED];  // Rates of the pending commands
+    bool pending[GOVERNED];
+    uint8_t fill_pct;
+    uint32_t lag_us;
+    uint32_t lost;
+    uint32_t steps_down;
+} governor;
+
+static struct nmea_cmd governor_cmds[GOVERNED];
+static char governor_bodies[GOVERNED][GOVERNOR_BODY_LEN];
+
+static void governor_eval(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(governor_work, governor_eval);
+
+void gnss_governor_rx(uint32_t used, uint32_t lost)
+{
+    k_spinlock_key_t key = k_spin_lock(&window.lock);
+
+    window.peak = MAX(window.peak, used);
+    window.lost += lost;
+    k_spin_unlock(&window.lock, key);
+}
+
+void gnss_governor_queued(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&window.lock);
+
+    window.queued_at = k_cycle_get_32();
+    window.queued = true;
+    k_spin_unlock(&window.lock, key);
+}
+
+void gnss_governor_run(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&window.lock);
+
+    if (window.queued)
+    {
+        window.lag_max = MAX(window.lag_max, k_cycle_get_32() - window.queued_at);
+        window.queued = false;
+    }
+    k_spin_unlock(&window.lock, key);
+}
+
+// Runs in the parser or the system work queue
+static void governor_done(struct nmea_cmd *cmd, int result, const NMEA_Fields *response)
+{
+    size_t i = cmd - governor_cmds;
+
+    ARG_UNUSED(response);
+
+    if (result == 0)
+    {
+        governor.sent[i] = governor.want[i];
+    }
+    else
+    {
+        // Tried again at the next evaluation
+        LOG_WRN("PAIR062 for %s failed (%d)", (i == 0) ? "GSV" : "GSA", result);
+    }
+    governor.pending[i] = false;
+}
+
+static uint8_t governor_rate(size_t i)
+{
+    uint8_t rate = governor.base[i];
+
+    // A sentence the profile turned off stays off
+    for (uint8_t step = 0; (step < governor.level) && (rate != 0); step++)
+    {
+        if (governor_steps[step].sentence == governor_sentences[i])
+        {
+            rate = (governor_steps[step].rate == 0) ? 0 : MAX(rate, governor_steps[step].rate);
+        }
+    }
+    return rate;
+}
+
+static void governor_apply(void)
+{
+    for (size_t i = 0; i < GOVERNED; i++)
+    {
+        uint8_t rate = governor_rate(i);
+
+        if (governor.pending[i] || (rate == governor.sent[i]))
+        {
+            continue;
+        }
+
+        snprintk(governor_bodies[i], GOVERNOR_BODY_LEN, "PAIR062,%d,%u",
+                 governor_sentences[i], rate);
+        nmea_cmd_init(&governor_cmds[i], governor_bodies[i], governor_done, NULL);
+        governor.want[i] = rate;
+        governor.pending[i] = true;
+        if (nmea_cmd_submit(&governor_cmds[i]) != 0)
+        {
+            // TX queue full: that is pressure too, try next period
+            governor.pending[i] = false;
+        }
+    }
+}
+
+static void governor_eval(struct k_work *work)
+{
+    uint32_t peak, lost, lag;
+    k_spinlock_key_t key = k_spin_lock(&window.lock);
+
+    peak = window.peak;
+    lost = window.lost;
+    lag = window.lag_max;
+    window.peak = 0;
+    window.lost = 0;
+    window.lag_max = 0;
+    k_spin_unlock(&window.lock, key);
+
+    governor.fill_pct = peak * 100 / governor.capacity;
+    governor.lag_us = k_cyc_to_us_ceil32(lag);
+    governor.lost += lost;
+
+    if ((lost > 0) || (governor.fill_pct >= CONFIG_LC29H_GOVERNOR_HIGH_PCT) ||
+        (governor.lag_us >= CONFIG_LC29H_GOVERNOR_LAG_MS * 1000))
+    {
+        governor.calm = 0;
+        if (governor.level < GNSS_GOVERNOR_LEVELS - 1)
+        {
+            governor.level++;
+            governor.steps_down++;
+            LOG_WRN("Receive load: ring %u%%, lag %u us, %u lost; level %u",
+                    governor.fill_pct, governor.lag_us, lost, governor.level);
+        }
+    }
+    else if ((governor.fill_pct < CONFIG_LC29H_GOVERNOR_LOW_PCT) &&
+             (governor.lag_us < CONFIG_LC29H_GOVERNOR_LAG_MS * 500))
+    {
+        if ((governor.level > 0) && (++governor.calm >= CONFIG_LC29H_GOVERNOR_HOLD))
+        {
+            governor.calm = 0;
+            governor.level--;
+            LOG_INF("Receive load down; level %u", governor.level);
+        }
+    }
+    else
+    {
+        governor.calm = 0;
+    }
+
+    governor_apply();
+    k_work_reschedule(&governor_work, K_MSEC(CONFIG_LC29H_GOVERNOR_PERIOD_MS));
+}
+
+void gnss_governor_init(uint32_t capacity)
+{
+    struct lc29h_profile profile;
+
+    // The rates to come back to are the ones the profile applied
+    lc29h_profile_default(&profile);
+    for (size_t i = 0; i < GOVERNED; i++)
+    {
+        governor.base[i] = profile.rates[governor_sentences[i]];
+        governor.sent[i] = governor.base[i];
+    }
+    governor.capacity = capacity;
+    k_work_reschedule(&governor_work, K_MSEC(CONFIG_LC29H_GOVERNOR_PERIOD_MS));
+}
+
+void gnss_governor_get(struct gnss_governor_status *status)
+{
+    status->level = governor.level;
+    status->gsv_rate = governor.sent[0];
+    status->gsa_rate = governor.sent[1];
+    status->fill_pct = governor.fill_pct;
+    status->lag_us = governor.lag_us;
+    status->lost = governor.lost;
+    status->steps_down = governor.steps_down;
+}
@@ -0,0 +1,53 @@
+#ifndef _GNSS_GOVERNOR_H_
+#define _GNSS_GOVERNOR_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef CONFIG_LC29H_GOVERNOR
+/* Output rate governor (see CONFIG_LC29H_GOVERNOR). Each period it
+ * looks at the peak ring buffer fill, lost bytes and the delay from
+ * waking the parser thread to it running. Under pressure it steps the
+ * receiver down one level; after LC29H_GOVERNOR_HOLD quiet periods it
+ * steps back up:
+ *
+ *   0  profile rates
+ *   1  GSV every LC29H_GOVERNOR_DIVIDER fixes
+ *   2  GSA every LC29H_GOVERNOR_DIVIDER fixes as well
+ *   3  GSV off
+ *   4  GSA off
+ *
+ * Position sentences are never touched. */
+#define GNSS_GOVERNOR_LEVELS 5
+
+struct gnss_governor_status
+{
+    uint8_t level;
+    uint8_t gsv_rate;        // Output every Nth fix, 0 = off
+    uint8_t gsa_rate;
+    uint8_t fill_pct;        // Peak ring fill of the last period
+    uint32_t lag_us;         // Longest parser delay of the last period
+    uint32_t lost;           // Bytes lost since boot
+    uint32_t steps_down;     // Level increases since boot
+};
+
+// Start watching a ring of capacity bytes, after the profile is applied
+void gnss_governor_init(uint32_t capacity);
+
+// Receive context: the ring holds used bytes, lost bytes did not fit
+void gnss_governor_rx(uint32_t used, uint32_t lost);
+
+// Receive context: the parser thread was woken (not already awake)
+void gnss_governor_queued(void);
+
+// Parser: thread running
+void gnss_governor_run(void);
+
+void gnss_governor_get(struct gnss_governor_status *status);
+#else
+#define gnss_governor_rx(used, lost) ((void)0)
+#define gnss_governor_queued() ((void)0)
+#define gnss_governor_run() ((void)0)
+#endif
+
+#endif
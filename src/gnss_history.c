@@ -0,0 +1,414 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <math.h>
+#include <string.h>
+#include "gnss_history.h"
+
+LOG_MODULE_REGISTER(gnss_history, CONFIG_LOG_DEFAULT_LEVEL);
+
+#define DAY_MS 86400000
+
+/* Entry codec */
+
+static uint8_t *put_varint(uint8_t *out, uint32_t value)
+{
+    while (value >= 0x80) 
+    {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+// Small magnitudes of either sign map to small codes: 0, -1, 1, -2 ...
+static uint8_t *put_zigzag(uint8_t *out, int32_t value)
+{
+    return put_varint(out, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+// NULL when the varint runs past end or is longer than 32 bits
+static const uint8_t *get_varint(const uint8_t *in, const uint8_t *end, uint32_t *value)
+{
+    uint32_t result = 0;
+
+    for (int shift = 0; (shift < 35) && (in < end); shift += 7) 
+    {
+        uint8_t byte = *in++;
+
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) 
+        {
+            *value = result;
+            return in;
+        }
+    }
+    return NULL;
+}
+
+static const uint8_t *get_zigzag(const uint8_t *in, const uint8_t *end, int32_t *value)
+{
+    uint32_t raw;
+
+    in = get_varint(in, end, &raw);
+    if (in != NULL) 
+    {
+        *value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+    }
+    return in;
+}
+
+bool gnss_history_fix_get(struct gnss_history_fix *fix, const GNSS_Data *data,
+                          const TimeStruct *utc)
+{
+    if ((data->fix_quality == 0) || !utc->valid) 
+    {
+        return false;
+    }
+
+    fix->time_ms = ((utc->hours * 60 + utc->minutes) * 60 + utc->seconds) * 1000U + utc->millis;
+    fix->year = data->year;
+    fix->month = data->month;
+    fix->day = data->day;
+    fix->latitude = data->latitude;
+    fix->longitude = data->longitude;
+#ifdef CONFIG_LC29H_NMEA_GGA
+    fix->altitude = (int32_t)lroundf(data->altitude * 100.0f);
+#else
+    fix->altitude = 0;
+#endif
+    return true;
+}
+
+size_t gnss_history_encode(struct gnss_history_codec *codec, const struct gnss_history_fix *fix,
+                           bool keyframe, uint8_t *out)
+{
+    struct gnss_history_fix *prev = &codec->prev;
+    uint8_t *p = out + 1;
+
+    // Deltas carry no date, so a new day starts a keyframe
+    if (!codec->valid || (fix->day != prev->day) || (fix->month != prev->month) ||
+        (fix->year != prev->year)) 
+    {
+        keyframe = true;
+    }
+
+    if (keyframe) 
+    {
+        *out = GNSS_HISTORY_KEYFRAME;
+        p = put_varint(p, fix->time_ms);
+        *p++ = (fix->year >= 2000) ? (uint8_t)(fix->year - 2000) : 0;
+        *p++ = fix->month;
+        *p++ = fix->day;
+        p = put_zigzag(p, fix->latitude);
+        p = put_zigzag(p, fix->longitude);
+        p = put_zigzag(p, fix->altitude);
+        codec->dt_ms = 0;
+    }
+    else 
+    {
+        int32_t dt = (int32_t)fix->time_ms - (int32_t)prev->time_ms;
+
+        *out = 0;
+        if (dt == codec->dt_ms) 
+        {
+            *out |= GNSS_HISTORY_SAME_DT;
+        }
+        else 
+        {
+            p = put_zigzag(p, dt);
+            codec->dt_ms = dt;
+        }
+        p = put_zigzag(p, (int32_t)((uint32_t)fix->latitude - (uint32_t)prev->latitude));
+        p = put_zigzag(p, (int32_t)((uint32_t)fix->longitude - (uint32_t)prev->longitude));
+        p = put_zigzag(p, (int32_t)((uint32_t)fix->altitude - (uint32_t)prev->altitude));
+    }
+
+    *prev = *fix;
+    codec->valid = true;
+    return p - out;
+}
+
+size_t gnss_history_decode(struct gnss_history_codec *codec, const uint8_t *in, size_t len,
+                           struct gnss_history_fix *fix)
+{
+    const uint8_t *end = in + len;
+    const uint8_t *p = in + 1;
+    struct gnss_history_fix next;
+    int32_t dlat;
+    int32_t dlon;
+    int32_t dalt;
+
+    if (len == 0) 
+    {
+        return 0;
+    }
+
+    if (in[0] & GNSS_HISTORY_KEYFRAME) 
+    {
+        p = get_varint(p, end, &next.time_ms);
+        if ((p == NULL) || (end - p < 3)) 
+        {
+            return 0;
+        }
+        next.year = (p[0] != 0) ? 2000 + p[0] : 0;
+        next.month = p[1];
+        next.day = p[2];
+        p += 3;
+        p = get_zigzag(p, end, &next.latitude);
+        p = (p != NULL) ? get_zigzag(p, end, &next.longitude) : NULL;
+        p = (p != NULL) ? get_zigzag(p, end, &next.altitude) : NULL;
+        if (p == NULL) 
+        {
+            return 0;
+        }
+        codec->dt_ms = 0;
+    }
+    else 
+    {
+        int32_t dt = codec->dt_ms;
+        int32_t time_ms;
+
+        if (!codec->valid) 
+        {
+            return 0;
+        }
+        if ((in[0] & GNSS_HISTORY_SAME_DT) == 0) 
+        {
+            p = get_zigzag(p, end, &dt);
+        }
+        p = (p != NULL) ? get_zigzag(p, end, &dlat) : NULL;
+        p = (p != NULL) ? get_zigzag(p, end, &dlon) : NULL;
+        p = (p != NULL) ? get_zigzag(p, end, &dalt) : NULL;
+        if (p == NULL) 
+        {
+            return 0;
+        }
+
+        next = codec->prev;
+        time_ms = (int32_t)next.time_ms + dt;
+        next.time_ms = (uint32_t)((time_ms % DAY_MS + DAY_MS) % DAY_MS);
+        next.latitude = (int32_t)((uint32_t)next.latitude + (uint32_t)dlat);
+        next.longitude = (int32_t)((uint32_t)next.longitude + (uint32_t)dlon);
+        next.altitude = (int32_t)((uint32_t)next.altitude + (uint32_t)dalt);
+        codec->dt_ms = dt;
+    }
+
+    codec->prev = next;
+    codec->valid = true;
+    *fix = next;
+    return p - in;
+}
+
+#ifdef CONFIG_LC29H_HISTORY
+
+/* Encoded entries in a byte ring. Positions count bytes since boot and
+ * index the ring modulo its size, so wrapped entries need no special
+ * case until they are copied out. Keyframe positions are kept to drop
+ * whole blocks from the tail. */
+#define HISTORY_SIZE CONFIG_LC29H_HISTORY_SIZE
+#define HISTORY_KEYS 32
+
+BUILD_ASSERT(IS_POWER_OF_TWO(HISTORY_SIZE), "CONFIG_LC29H_HISTORY_SIZE must be a power of two");
+
+static uint8_t history_buf[HISTORY_SIZE];
+static struct k_spinlock history_lock;
+
+static struct 
+{
+    uint32_t head;                 // Position of the next entry
+    uint32_t tail;                 // Position of the oldest entry, always a keyframe
+    uint32_t fixes;                // Entries between tail and head
+    uint32_t since_key;            // Entries since the last keyframe
+    struct gnss_history_codec codec;
+    struct 
+    {
+        uint32_t pos;
+        uint32_t fixes;            // Entries in the block it starts
+    } keys[HISTORY_KEYS];
+    uint8_t key_first;
+    uint8_t key_count;
+} history;
+
+// Copy up to len bytes from position pos out of the ring
+static void history_read(uint32_t pos, uint8_t *out, uint32_t len)
+{
+    uint32_t offset = pos & (HISTORY_SIZE - 1);
+    uint32_t first = MIN(len, HISTORY_SIZE - offset);
+
+    memcpy(out, &history_buf[offset], first);
+    memcpy(out + first, history_buf, len - first);
+}
+
+static void history_write(uint32_t pos, const uint8_t *in, uint32_t len)
+{
+    uint32_t offset = pos & (HISTORY_SIZE - 1);
+    uint32_t first = MIN(len, HISTORY_SIZE - offset);
+
+    memcpy(&history_buf[offset], in, first);
+    memcpy(history_buf, in + first, len - first);
+}
+
+// Drop the oldest keyframe block; the history is empty if it was the only one
+static void history_drop_block(void)
+{
+    history.fixes -= history.keys[history.key_first].fixes;
+    history.key_first = (history.key_first + 1) % HISTORY_KEYS;
+    history.key_count--;
+
+    if (history.key_count == 0) 
+    {
+        history.tail = history.head;
+        history.codec.valid = false;
+    }
+    else 
+    {
+        history.tail = history.keys[history.key_first].pos;
+    }
+}
+
+void gnss_history_add(const GNSS_Data *data, const TimeStruct *utc)
+{
+    struct gnss_history_fix fix;
+    uint8_t entry[GNSS_HISTORY_ENTRY_MAX];
+    struct gnss_history_codec codec;
+    bool keyframe;
+    size_t len;
+
+    if (!gnss_history_fix_get(&fix, data, utc)) 
+    {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&history_lock);
+
+    keyframe = (history.key_count == 0) ||
+               (history.since_key >= CONFIG_LC29H_HISTORY_KEYFRAME_INTERVAL);
+    codec = history.codec;
+    len = gnss_history_encode(&codec, &fix, keyframe, entry);
+    keyframe = (entry[0] & GNSS_HISTORY_KEYFRAME) != 0;
+
+    // Make room; a delta whose keyframe was dropped becomes a keyframe
+    while ((HISTORY_SIZE - (history.head - history.tail) < len) ||
+           (keyframe && (history.key_count == HISTORY_KEYS))) 
+    {
+        history_drop_block();
+        if (!keyframe && (history.key_count == 0)) 
+        {
+            codec = history.codec;
+            len = gnss_history_encode(&codec, &fix, true, entry);
+            keyframe = true;
+        }
+    }
+
+    history_write(history.head, entry, len);
+    if (keyframe) 
+    {
+        uint8_t slot = (history.key_first + history.key_count) % HISTORY_KEYS;
+
+        history.keys[slot].pos = history.head;
+        history.keys[slot].fixes = 0;
+        history.key_count++;
+        history.since_key = 0;
+    }
+    history.keys[(history.key_first + history.key_count - 1) % HISTORY_KEYS].fixes++;
+    history.since_key++;
+    history.fixes++;
+    history.head += len;
+    history.codec = codec;
+
+    k_spin_unlock(&history_lock, key);
+}
+
+void gnss_history_iter_init(struct gnss_history_iter *iter)
+{
+    k_spinlock_key_t key = k_spin_lock(&history_lock);
+
+    iter->pos = history.tail;
+    iter->codec.valid = false;
+    k_spin_unlock(&history_lock, key);
+}
+
+bool gnss_history_iter_next(struct gnss_history_iter *iter, struct gnss_history_fix *fix)
+{
+    uint8_t entry[GNSS_HISTORY_ENTRY_MAX];
+    uint32_t avail;
+    size_t len;
+
+    k_spinlock_key_t key = k_spin_lock(&history_lock);
+
+    if ((iter->pos - history.tail) > (history.head - history.tail)) 
+    {
+        // Overtaken: the entries it pointed at were dropped
+        iter->pos = history.tail;
+        iter->codec.valid = false;
+    }
+
+    avail = MIN(history.head - iter->pos, sizeof(entry));
+    history_read(iter->pos, entry, avail);
+    k_spin_unlock(&history_lock, key);
+
+    len = gnss_history_decode(&iter->codec, entry, avail, fix);
+    iter->pos += len;
+    return len > 0;
+}
+
+size_t gnss_history_serialize(struct gnss_history_iter *iter, uint8_t *buf, size_t size,
+                              uint32_t *count)
+{
+    struct gnss_history_codec codec = {0};
+    uint8_t entry[GNSS_HISTORY_ENTRY_MAX];
+    struct gnss_history_fix fix;
+    struct gnss_history_iter next;
+    size_t used = 3;
+    size_t len;
+
+    *count = 0;
+    if (size < used) 
+    {
+        return 0;
+    }
+    buf[0] = 'G';
+    buf[1] = 'H';
+    buf[2] = 1;     // Format version
+
+    for (next = *iter; gnss_history_iter_next(&next, &fix); *iter = next) 
+    {
+        struct gnss_history_codec saved = codec;
+
+        len = gnss_history_encode(&codec, &fix, false, entry);
+        if (used + len > size) 
+        {
+            codec = saved;
+            break;
+        }
+        memcpy(&buf[used], entry, len);
+        used += len;
+        (*count)++;
+    }
+
+    return (*count > 0) ? used : 0;
+}
+
+void gnss_history_usage(uint32_t *fixes, uint32_t *bytes)
+{
+    k_spinlock_key_t key = k_spin_lock(&history_lock);
+
+    *fixes = history.fixes;
+    *bytes = history.head - history.tail;
+    k_spin_unlock(&history_lock, key);
+}
+
+void gnss_history_clear(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&history_lock);
+
+    history.tail = history.head;
+    history.fixes = 0;
+    history.since_key = 0;
+    history.key_count = 0;
+    history.codec.valid = false;
+    k_spin_unlock(&history_lock, key);
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef _GNSS_HISTORY_H_
+#define _GNSS_HISTORY_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/sys/util.h>
+#include "nmea.h"
+
+/* One stored fix */
+struct gnss_history_fix 
+{
+    uint32_t time_ms;     // UTC ms since midnight
+    uint16_t year;        // UTC date, 0 if unknown
+    uint8_t month;
+    uint8_t day;
+    int32_t latitude;     // 1e-7 degrees
+    int32_t longitude;    // 1e-7 degrees
+    int32_t altitude;     // cm above mean sea level
+};
+
+/* Entry codec, shared by the RAM history and the flash track log.
+ *
+ * Every entry starts with a header byte. A keyframe holds the absolute
+ * fix; a delta holds the difference to the previous fix, each value as
+ * a zigzag varint. A delta whose time step equals the previous step
+ * omits it, so a steady 1 Hz track costs 4-8 bytes per fix.
+ *
+ *   keyframe: hdr, time_ms, year-2000, month, day, lat, lon, alt
+ *   delta:    hdr, [dt_ms], dlat, dlon, dalt
+ */
+#define GNSS_HISTORY_KEYFRAME  BIT(0)
+#define GNSS_HISTORY_SAME_DT   BIT(1)
+
+#define GNSS_HISTORY_ENTRY_MAX 24   // Longest encoded entry
+
+// Decoder / encoder state: the last fix and time step of the stream
+struct gnss_history_codec 
+{
+    struct gnss_history_fix prev;
+    int32_t dt_ms;
+    bool valid;           // prev holds a fix; false forces a keyframe
+};
+
+// Fill fix from a published epoch; false if the epoch has no fix or time
+bool gnss_history_fix_get(struct gnss_history_fix *fix, const GNSS_Data *data,
+                          const TimeStruct *utc);
+
+// Encode fix at out (GNSS_HISTORY_ENTRY_MAX bytes); keyframe if requested or needed
+size_t gnss_history_encode(struct gnss_history_codec *codec, const struct gnss_history_fix *fix,
+                           bool keyframe, uint8_t *out);
+
+// Decode one entry of at most len bytes; 0 if it is truncated or needs a keyframe first
+size_t gnss_history_decode(struct gnss_history_codec *codec, const uint8_t *in, size_t len,
+                           struct gnss_history_fix *fix);
+
+#ifdef CONFIG_LC29H_HISTORY
+/* RAM history (CONFIG_LC29H_HISTORY). The oldest keyframe block is
+ * dropped when the ring is full, so the history always starts with a
+ * keyframe and can be decoded from its first entry. */
+
+struct gnss_history_iter 
+{
+    uint32_t pos;         // Stream position of the next entry
+    struct gnss_history_codec codec;
+};
+
+// Add the fix of a published epoch (called by the parser)
+void gnss_history_add(const GNSS_Data *data, const TimeStruct *utc);
+
+// Position iter at the oldest stored fix
+void gnss_history_iter_init(struct gnss_history_iter *iter);
+
+/* Next fix, oldest first; false at the end. If the writer overtook the
+ * iterator, it continues at the oldest fix still stored. */
+bool gnss_history_iter_next(struct gnss_history_iter *iter, struct gnss_history_fix *fix);
+
+/* Serialize fixes from iter into a self-contained batch of at most size
+ * bytes: "GH", version, then entries starting with a keyframe. Stops
+ * before the first entry that does not fit, so repeated calls stream
+ * the history in chunks. Returns the bytes written, 0 if none left. */
+size_t gnss_history_serialize(struct gnss_history_iter *iter, uint8_t *buf, size_t size,
+                              uint32_t *count);
+
+// Number of fixes and bytes stored
+void gnss_history_usage(uint32_t *fixes, uint32_t *bytes);
+
+// Drop every stored fix
+void gnss_history_clear(void);
+#endif
+
+#endif
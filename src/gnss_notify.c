@@ -0,0 +1,64 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+#include <errno.h>
+#include "gnss_notify.h"
+
+static sys_slist_t gnss_subscribers = SYS_SLIST_STATIC_INIT(&gnss_subscribers);
+static struct k_spinlock gnss_subscribers_lock;
+
+int gnss_subscribe(struct gnss_subscriber *sub)
+{
+    if ((sub == NULL) || (sub->signal == NULL) || (sub->events == 0)) 
+    {
+        return -EINVAL;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&gnss_subscribers_lock);
+
+    sub->skipped = 0;
+    sys_slist_find_and_remove(&gnss_subscribers, &sub->node);
+    sys_slist_append(&gnss_subscribers, &sub->node);
+
+    k_spin_unlock(&gnss_subscribers_lock, key);
+    return 0;
+}
+
+void gnss_unsubscribe(struct gnss_subscriber *sub)
+{
+    k_spinlock_key_t key = k_spin_lock(&gnss_subscribers_lock);
+
+    sys_slist_find_and_remove(&gnss_subscribers, &sub->node);
+
+    k_spin_unlock(&gnss_subscribers_lock, key);
+}
+
+void gnss_notify(uint32_t events)
+{
+    struct gnss_subscriber *sub;
+    k_spinlock_key_t key = k_spin_lock(&gnss_subscribers_lock);
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&gnss_subscribers, sub, node) 
+    {
+        uint32_t match = sub->events & events;
+
+        if (match == 0) 
+        {
+            continue;
+        }
+
+        // Rate divider: pass one matching epoch out of every N
+        if (++sub->skipped < sub->divider) 
+        {
+            continue;
+        }
+        sub->skipped = 0;
+
+        // A pending result is merged, so a slow reader never loses a class
+        unsigned int signaled;
+        int pending;
+        k_poll_signal_check(sub->signal, &signaled, &pending);
+        k_poll_signal_raise(sub->signal, match | (signaled ? pending : 0));
+    }
+
+    k_spin_unlock(&gnss_subscribers_lock, key);
+}
@@ -0,0 +1,48 @@
+#ifndef _GNSS_NOTIFY_H_
+#define _GNSS_NOTIFY_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+
+/* Update classes carried by an epoch */
+#define GNSS_EVT_POSITION    BIT(0)  // GGA, RMC or GLL
+#define GNSS_EVT_TIME        BIT(1)  // Valid UTC time
+#define GNSS_EVT_SATELLITES  BIT(2)  // GSA or GSV
+
+/* One listener for published epochs. The signal is raised with the
+ * GNSS_EVT_* bits of the epoch as its result; the listener then reads
+ * the data with gnss_get_snapshot(). Example:
+ *
+ *     static struct k_poll_signal fix_signal;
+ *     static struct gnss_subscriber fix_sub = {
+ *         .signal = &fix_signal, .events = GNSS_EVT_POSITION, .divider = 10,
+ *     };
+ *
+ *     k_poll_signal_init(&fix_signal);
+ *     gnss_subscribe(&fix_sub);
+ *     struct k_poll_event evt = K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL,
+ *                                     K_POLL_MODE_NOTIFY_ONLY, &fix_signal);
+ *     for (;;) {
+ *         k_poll(&evt, 1, K_FOREVER);
+ *         k_poll_signal_reset(&fix_signal);
+ *         evt.state = K_POLL_STATE_NOT_READY;
+ *         gnss_get_snapshot(&snapshot);
+ *     }
+ */
+struct gnss_subscriber 
+{
+    sys_snode_t node;              // Private
+    struct k_poll_signal *signal;  // Raised on a matching epoch
+    uint32_t events;               // GNSS_EVT_* of interest
+    uint16_t divider;              // Notify every Nth matching epoch, 0 or 1 for all
+    uint16_t skipped;              // Private
+};
+
+// Register a subscriber; it must stay valid until unsubscribed
+int gnss_subscribe(struct gnss_subscriber *sub);
+void gnss_unsubscribe(struct gnss_subscriber *sub);
+
+// Called by the parser once per published epoch
+void gnss_notify(uint32_t events);
+
+#endif
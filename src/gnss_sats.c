@@ -0,0 +1,355 @@
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include "nmea.h"
+#include "gnss_sats.h"
+
+const char *const gnss_system_names[GNSS_SYSTEM_COUNT] =
+{
+    "GPS", "SBAS", "GLONASS", "Galileo", "BeiDou", "QZSS", "NavIC",
+};
+
+// Satellite numbers of each system, and where they start in sats_index
+static const struct
+{
+    uint8_t first;
+    uint8_t count;
+    uint8_t offset;
+} sats_ranges[GNSS_SYSTEM_COUNT] =
+{
+    [GNSS_SYSTEM_GPS]     = { 1, 32, 0 },
+    [GNSS_SYSTEM_SBAS]    = { 33, 32, 32 },
+    [GNSS_SYSTEM_GLONASS] = { 65, 32, 64 },
+    [GNSS_SYSTEM_GALILEO] = { 1, 36, 96 },
+    [GNSS_SYSTEM_BEIDOU]  = { 1, 63, 132 },
+    [GNSS_SYSTEM_QZSS]    = { 1, 10, 195 },
+    [GNSS_SYSTEM_NAVIC]   = { 1, 14, 205 },
+};
+#define SATS_IDS 219
+
+// GSV talker of each system; SBAS comes with GPS
+static const uint8_t sats_talkers[GNSS_SYSTEM_COUNT] =
+{
+    [GNSS_SYSTEM_GPS]     = NMEA_TALKER_GP,
+    [GNSS_SYSTEM_SBAS]    = NMEA_TALKER_UNKNOWN,
+    [GNSS_SYSTEM_GLONASS] = NMEA_TALKER_GL,
+    [GNSS_SYSTEM_GALILEO] = NMEA_TALKER_GA,
+    [GNSS_SYSTEM_BEIDOU]  = NMEA_TALKER_GB,
+    [GNSS_SYSTEM_QZSS]    = NMEA_TALKER_GQ,
+    [GNSS_SYSTEM_NAVIC]   = NMEA_TALKER_GI,
+};
+
+// NMEA 4.11 signal IDs are one hex digit
+#define SATS_SIGNAL_IDS 16
+
+struct sats_entry
+{
+    struct gnss_sat sat;     // signals == 0 while the entry is free
+    uint8_t group;           // System of the GSV talker reporting it
+    uint8_t pass[CONFIG_LC29H_SATS_SIGNALS];   // GSV group pass of the last report
+    uint16_t seen[CONFIG_LC29H_SATS_SIGNALS];  // sats_epoch of the last report
+};
+
+static struct sats_entry sats[CONFIG_LC29H_SATS_MAX];
+static uint8_t sats_index[SATS_IDS];           // Entry + 1, 0 if not in view
+static uint8_t sats_free[CONFIG_LC29H_SATS_MAX];
+static uint8_t sats_free_count;
+static uint8_t sats_top;                       // Entries ever used
+static uint8_t sats_count;
+static uint16_t sats_epoch;
+
+/* GSV groups, per talker system and signal: the pass (one per message
+ * 1) and the message expected next, 0 once one was missed */
+static struct
+{
+    uint8_t pass;
+    uint8_t next;
+} sats_groups[GNSS_SYSTEM_COUNT][SATS_SIGNAL_IDS];
+
+// GSV sentence being parsed
+static struct
+{
+    bool valid;
+    uint8_t group;
+    uint8_t signal;
+} sats_gsv;
+
+// Readers copy under the lock; the parser is the only writer
+static struct k_spinlock sats_lock;
+
+static int sats_id(uint8_t system, uint8_t prn)
+{
+    if ((system >= GNSS_SYSTEM_COUNT) || (prn < sats_ranges[system].first) ||
+        (prn - sats_ranges[system].first >= sats_ranges[system].count))
+    {
+        return -1;
+    }
+    return sats_ranges[system].offset + prn - sats_ranges[system].first;
+}
+
+static struct sats_entry *sats_lookup(uint8_t system, uint8_t prn)
+{
+    int id = sats_id(system, prn);
+
+    return ((id < 0) || (sats_index[id] == 0)) ? NULL : &sats[sats_index[id] - 1];
+}
+
+static void sats_drop_signal(struct sats_entry *entry, uint8_t slot)
+{
+    struct gnss_sat *sat = &entry->sat;
+    uint8_t last = --sat->signals;
+
+    sat->signal[slot] = sat->signal[last];
+    sat->snr[slot] = sat->snr[last];
+    entry->pass[slot] = entry->pass[last];
+    entry->seen[slot] = entry->seen[last];
+
+    if (last == 0)
+    {
+        sats_index[sats_id(sat->system, sat->prn)] = 0;
+        sats_free[sats_free_count++] = entry - sats;
+        sats_count--;
+    }
+}
+
+void gnss_sats_gsv_begin(uint8_t talker, uint8_t signal, uint8_t message)
+{
+    sats_gsv.valid = false;
+    if ((talker == NMEA_TALKER_UNKNOWN) || (signal >= SATS_SIGNAL_IDS))
+    {
+        return;
+    }
+    for (uint8_t group = 0; group < GNSS_SYSTEM_COUNT; group++)
+    {
+        if (sats_talkers[group] == talker)
+        {
+            sats_gsv.valid = true;
+            sats_gsv.group = group;
+            sats_gsv.signal = signal;
+            break;
+        }
+    }
+    if (!sats_gsv.valid)
+    {
+        return;
+    }
+
+    if (message == 1)
+    {
+        sats_groups[sats_gsv.group][signal].pass++;
+        sats_groups[sats_gsv.group][signal].next = 2;
+    }
+    else if (message == sats_groups[sats_gsv.group][signal].next)
+    {
+        sats_groups[sats_gsv.group][signal].next++;
+    }
+    else
+    {
+        // A part went missing; this pass proves nothing
+        sats_groups[sats_gsv.group][signal].next = 0;
+    }
+}
+
+void gnss_sats_gsv_sat(uint8_t prn, int8_t elevation, uint16_t azimuth, uint8_t snr)
+{
+    struct sats_entry *entry;
+    uint8_t system = sats_gsv.group;
+    uint8_t slot;
+    int id;
+
+    if (!sats_gsv.valid)
+    {
+        return;
+    }
+    // GPS talkers also report SBAS, and QZSS in the old 193..202 numbering
+    if ((prn >= 193) && (prn <= 202) && ((system == GNSS_SYSTEM_GPS) || (system == GNSS_SYSTEM_QZSS)))
+    {
+        system = GNSS_SYSTEM_QZSS;
+        prn -= 192;
+    }
+    else if ((system == GNSS_SYSTEM_GPS) && (prn >= 33) && (prn <= 64))
+    {
+        system = GNSS_SYSTEM_SBAS;
+    }
+    id = sats_id(system, prn);
+    if (id < 0)
+    {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&sats_lock);
+
+    if (sats_index[id] == 0)
+    {
+        uint8_t free;
+
+        if (sats_free_count > 0)
+        {
+            free = sats_free[--sats_free_count];
+        }
+        else if (sats_top < CONFIG_LC29H_SATS_MAX)
+        {
+            free = sats_top++;
+        }
+        else
+        {
+            k_spin_unlock(&sats_lock, key);
+            return;
+        }
+        sats[free].sat.system = system;
+        sats[free].sat.prn = prn;
+        sats[free].sat.signals = 0;
+        sats_index[id] = free + 1;
+        sats_count++;
+    }
+    entry = &sats[sats_index[id] - 1];
+
+    for (slot = 0; slot < entry->sat.signals; slot++)
+    {
+        if (entry->sat.signal[slot] == sats_gsv.signal)
+        {
+            break;
+        }
+    }
+    if (slot == CONFIG_LC29H_SATS_SIGNALS)
+    {
+        // More signals than slots: the one reported longest ago gives way
+        slot = 0;
+        for (uint8_t i = 1; i < CONFIG_LC29H_SATS_SIGNALS; i++)
+        {
+            if ((uint16_t)(sats_epoch - entry->seen[i]) > (uint16_t)(sats_epoch - entry->seen[slot]))
+            {
+                slot = i;
+            }
+        }
+    }
+    else if (slot == entry->sat.signals)
+    {
+        entry->sat.signals++;
+    }
+
+    entry->group = sats_gsv.group;
+    entry->sat.elevation = elevation;
+    entry->sat.azimuth = azimuth;
+    entry->sat.signal[slot] = sats_gsv.signal;
+    entry->sat.snr[slot] = snr;
+    entry->pass[slot] = sats_groups[sats_gsv.group][sats_gsv.signal].pass;
+    entry->seen[slot] = sats_epoch;
+    k_spin_unlock(&sats_lock, key);
+}
+
+void gnss_sats_gsv_end(uint8_t message, uint8_t total)
+{
+    uint8_t pass;
+
+    // Only a group received whole tells which satellites are gone
+    if (!sats_gsv.valid || (message != total) ||
+        (sats_groups[sats_gsv.group][sats_gsv.signal].next != total + 1))
+    {
+        return;
+    }
+    pass = sats_groups[sats_gsv.group][sats_gsv.signal].pass;
+
+    k_spinlock_key_t key = k_spin_lock(&sats_lock);
+
+    for (uint8_t i = 0; i < sats_top; i++)
+    {
+        if ((sats[i].sat.signals == 0) || (sats[i].group != sats_gsv.group))
+        {
+            continue;
+        }
+        for (uint8_t slot = sats[i].sat.signals; slot-- > 0;)
+        {
+            if ((sats[i].sat.signal[slot] == sats_gsv.signal) && (sats[i].pass[slot] != pass))
+            {
+                sats_drop_signal(&sats[i], slot);
+            }
+        }
+    }
+    k_spin_unlock(&sats_lock, key);
+}
+
+void gnss_sats_epoch(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&sats_lock);
+
+    // Catches systems whose GSV stopped coming (throttled or turned off)
+    sats_epoch++;
+    for (uint8_t i = 0; i < sats_top; i++)
+    {
+        for (uint8_t slot = sats[i].sat.signals; slot-- > 0;)
+        {
+            if ((uint16_t)(sats_epoch - sats[i].seen[slot]) > CONFIG_LC29H_SATS_MAX_AGE)
+            {
+                sats_drop_signal(&sats[i], slot);
+            }
+        }
+    }
+    k_spin_unlock(&sats_lock, key);
+}
+
+uint8_t gnss_sats_count(void)
+{
+    return sats_count;
+}
+
+bool gnss_sats_get(uint8_t system, uint8_t prn, struct gnss_sat *sat)
+{
+    k_spinlock_key_t key = k_spin_lock(&sats_lock);
+    const struct sats_entry *entry = sats_lookup(system, prn);
+
+    if (entry != NULL)
+    {
+        *sat = entry->sat;
+    }
+    k_spin_unlock(&sats_lock, key);
+    return entry != NULL;
+}
+
+int gnss_sats_snr(uint8_t system, uint8_t signal, uint8_t prn)
+{
+    int snr = -ENOENT;
+    k_spinlock_key_t key = k_spin_lock(&sats_lock);
+    const struct sats_entry *entry = sats_lookup(system, prn);
+
+    for (uint8_t slot = 0; (entry != NULL) && (slot < entry->sat.signals); slot++)
+    {
+        if (entry->sat.signal[slot] == signal)
+        {
+            snr = entry->sat.snr[slot];
+            break;
+        }
+    }
+    k_spin_unlock(&sats_lock, key);
+    return snr;
+}
+
+uint8_t gnss_sats_list(struct gnss_sat *list, uint8_t max)
+{
+    uint8_t count = 0;
+    k_spinlock_key_t key = k_spin_lock(&sats_lock);
+
+    // In index order: by system, then satellite number
+    for (int id = 0; (id < SATS_IDS) && (count < max); id++)
+    {
+        if (sats_index[id] != 0)
+        {
+            list[count++] = sats[sats_index[id] - 1].sat;
+        }
+    }
+    k_spin_unlock(&sats_lock, key);
+    return count;
+}
+
+void gnss_sats_clear(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&sats_lock);
+
+    memset(sats_index, 0, sizeof(sats_index));
+    memset(sats_groups, 0, sizeof(sats_groups));
+    sats_free_count = 0;
+    sats_top = 0;
+    sats_count = 0;
+    sats_gsv.valid = false;
+    k_spin_unlock(&sats_lock, key);
+}
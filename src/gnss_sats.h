@@ -0,0 +1,61 @@
+#ifndef _GNSS_SATS_H_
+#define _GNSS_SATS_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/* Satellites in view from GSV, all systems (CONFIG_LC29H_NMEA_GSV).
+ * Each GSV part updates its satellites in place; a satellite signal is
+ * dropped when a complete GSV group of its system and signal no longer
+ * lists it, or after CONFIG_LC29H_SATS_MAX_AGE epochs without a report.
+ * Lookups by system and satellite number index a table directly. */
+
+enum gnss_system
+{
+    GNSS_SYSTEM_GPS,         // 1..32
+    GNSS_SYSTEM_SBAS,        // 33..64, reported as GP
+    GNSS_SYSTEM_GLONASS,     // 65..96
+    GNSS_SYSTEM_GALILEO,     // 1..36
+    GNSS_SYSTEM_BEIDOU,      // 1..63
+    GNSS_SYSTEM_QZSS,        // 1..10 (193..202 as GP are stored as 1..10)
+    GNSS_SYSTEM_NAVIC,       // 1..14
+    GNSS_SYSTEM_COUNT
+};
+
+struct gnss_sat
+{
+    uint8_t system;          // enum gnss_system
+    uint8_t prn;             // Satellite number as above
+    int8_t elevation;        // Degrees
+    uint16_t azimuth;        // Degrees
+    uint8_t signals;         // Entries used in signal[] and snr[]
+    uint8_t signal[CONFIG_LC29H_SATS_SIGNALS];  // NMEA 4.11 signal ID, 0 if not sent
+    uint8_t snr[CONFIG_LC29H_SATS_SIGNALS];     // dB-Hz, 0 if not tracked
+};
+
+extern const char *const gnss_system_names[GNSS_SYSTEM_COUNT];
+
+// Parser: satellites of a GSV sentence from talker (NMEA_Talker)
+void gnss_sats_gsv_begin(uint8_t talker, uint8_t signal, uint8_t message);
+void gnss_sats_gsv_sat(uint8_t prn, int8_t elevation, uint16_t azimuth, uint8_t snr);
+void gnss_sats_gsv_end(uint8_t message, uint8_t total);
+
+// Parser: an epoch was closed; ages out what was not reported lately
+void gnss_sats_epoch(void);
+
+// Satellites in the store
+uint8_t gnss_sats_count(void);
+
+// Copy one satellite; false if it is not in view
+bool gnss_sats_get(uint8_t system, uint8_t prn, struct gnss_sat *sat);
+
+// SNR of one signal of a satellite, -ENOENT if it is not reported
+int gnss_sats_snr(uint8_t system, uint8_t signal, uint8_t prn);
+
+// Copy up to max satellites; returns how many
+uint8_t gnss_sats_list(struct gnss_sat *sats, uint8_t max);
+
+// Drop every satellite
+void gnss_sats_clear(void);
+
+#endif
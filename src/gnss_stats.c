@@ -0,0 +1,79 @@
+#include <zephyr/kernel.h>
+#include <string.h>
+#include "gnss_stats.h"
+
+struct gnss_stats gnss_stats;
+
+/* Cycle stamps taken when a '$' arrives, tagged with the position of the
+ * '$' in the byte stream. The receive context pushes, the parser pops;
+ * positions keep them in step when sentences are dropped in between. */
+#define STAMP_SLOTS 16
+
+static struct 
+{
+    uint32_t pos;
+    uint32_t cycles;
+} stamps[STAMP_SLOTS];
+static atomic_t stamp_head;   // Written by the receive context
+static atomic_t stamp_tail;   // Written by the parser
+static uint32_t rx_pos;       // Bytes put into the ring since boot
+
+void gnss_stats_get(struct gnss_stats *stats, bool reset)
+{
+    unsigned int key = irq_lock();
+
+    *stats = gnss_stats;
+    if (reset) 
+    {
+        memset(&gnss_stats, 0, sizeof(gnss_stats));
+        gnss_stats.since = k_uptime_get();
+    }
+    irq_unlock(key);
+}
+
+void gnss_stats_rx(const uint8_t *data, uint32_t len, uint32_t put, uint32_t used)
+{
+    uint32_t now = k_cycle_get_32();
+    const uint8_t *end = data + put;
+    const uint8_t *p = data;
+
+    gnss_stats.bytes += len;
+    gnss_stats.overruns += len - put;
+    gnss_stats.ring_hwm = MAX(gnss_stats.ring_hwm, used);
+
+    while ((p = memchr(p, '$', end - p)) != NULL) 
+    {
+        atomic_val_t head = atomic_get(&stamp_head);
+
+        if (head - atomic_get(&stamp_tail) < STAMP_SLOTS) 
+        {
+            stamps[head % STAMP_SLOTS].pos = rx_pos + (p - data);
+            stamps[head % STAMP_SLOTS].cycles = now;
+            atomic_set(&stamp_head, head + 1);
+        }
+        p++;
+    }
+    rx_pos += put;
+}
+
+void gnss_stats_parsed(uint32_t pos)
+{
+    atomic_val_t tail = atomic_get(&stamp_tail);
+
+    // Skip stamps of sentences that were dropped before parsing
+    while ((tail != atomic_get(&stamp_head)) && ((int32_t)(stamps[tail % STAMP_SLOTS].pos - pos) < 0)) 
+    {
+        tail++;
+    }
+
+    if ((tail != atomic_get(&stamp_head)) && (stamps[tail % STAMP_SLOTS].pos == pos)) 
+    {
+        uint32_t latency = k_cycle_get_32() - stamps[tail % STAMP_SLOTS].cycles;
+
+        gnss_stats.latency_count++;
+        gnss_stats.latency_sum += latency;
+        gnss_stats.latency_max = MAX(gnss_stats.latency_max, latency);
+        tail++;
+    }
+    atomic_set(&stamp_tail, tail);
+}
@@ -0,0 +1,44 @@
+#ifndef _GNSS_STATS_H_
+#define _GNSS_STATS_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "nmea.h"
+
+#ifdef CONFIG_LC29H_STATS
+/* Receive pipeline statistics (see CONFIG_LC29H_STATS) */
+struct gnss_stats 
+{
+    int64_t since;                        // Uptime (ms) of the last reset
+    uint32_t bytes;                       // Bytes received from the UART
+    uint32_t overruns;                    // Bytes lost to a full ring buffer
+    uint32_t ring_hwm;                    // Ring buffer high-water mark
+    uint32_t overlong;                    // Sentences dropped by the framer
+    uint32_t checksum_errors;             // Sentences with a bad checksum
+    uint32_t malformed;                   // Sentences that could not be split
+    uint32_t sentences[NMEA_TYPE_COUNT];  // Handled per type, NMEA_UNKNOWN for the rest
+    uint32_t latency_count;               // Sentences with a latency sample
+    uint64_t latency_sum;                 // Cycles from the '$' interrupt to parsed
+    uint32_t latency_max;
+};
+
+extern struct gnss_stats gnss_stats;
+
+#define GNSS_STATS_INC(field) (gnss_stats.field++)
+
+void gnss_stats_get(struct gnss_stats *stats, bool reset);
+
+// Receive context: len bytes arrived, put of them fit in a ring now holding used bytes
+void gnss_stats_rx(const uint8_t *data, uint32_t len, uint32_t put, uint32_t used);
+
+// Parser: the sentence whose '$' is the pos-th byte read from the ring was parsed
+void gnss_stats_parsed(uint32_t pos);
+#else
+#define GNSS_STATS_INC(field)
+
+// Arguments are not evaluated when statistics are disabled
+#define gnss_stats_rx(data, len, put, used)
+#define gnss_stats_parsed(pos)
+#endif
+
+#endif
@@ -0,0 +1,489 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/sys/crc.h>
+#include <string.h>
+#include "gnss_track.h"
+
+LOG_MODULE_REGISTER(gnss_track, CONFIG_LOG_DEFAULT_LEVEL);
+
+// A board overlay may give the log its own partition
+#if FIXED_PARTITION_EXISTS(gnss_track_partition)
+#define TRACK_PARTITION_ID FIXED_PARTITION_ID(gnss_track_partition)
+#else
+#define TRACK_PARTITION_ID FIXED_PARTITION_ID(storage_partition)
+#endif
+
+#define TRACK_FCB_MAGIC 0x4B525447   // "GTRK"
+#define PAGE_SIZE CONFIG_LC29H_TRACK_PAGE_SIZE
+#define PAGE_ALIGN 8    // Pages are padded to the largest flash write block in use
+
+BUILD_ASSERT(PAGE_SIZE > sizeof(struct gnss_track_header) + GNSS_HISTORY_ENTRY_MAX,
+             "CONFIG_LC29H_TRACK_PAGE_SIZE too small for one fix");
+BUILD_ASSERT(PAGE_SIZE % PAGE_ALIGN == 0, "CONFIG_LC29H_TRACK_PAGE_SIZE must be a multiple of 8");
+
+/* Two RAM pages: the parser fills one while the work item writes the
+ * other. If both are waiting for flash, new fixes are dropped. */
+struct track_page 
+{
+    uint8_t buf[PAGE_SIZE];
+    uint16_t len;
+    uint8_t fixes;
+    bool sealed;          // Full, owned by the work item until written
+    struct gnss_history_codec codec;
+};
+
+static struct track_page track_pages[2];
+static uint8_t track_fill;
+static uint32_t track_seq;
+static uint32_t track_dropped;
+static bool track_ready;
+static struct k_spinlock track_lock;
+static struct k_work track_work;
+
+static struct fcb track_fcb;
+static struct flash_sector track_sectors[CONFIG_LC29H_TRACK_MAX_SECTORS];
+
+// Page read back from flash; walks run one at a time
+static uint8_t track_read_buf[PAGE_SIZE];
+static K_MUTEX_DEFINE(track_read_lock);
+
+static void track_page_reset(struct track_page *page)
+{
+    page->len = sizeof(struct gnss_track_header);
+    page->fixes = 0;
+    page->sealed = false;
+    page->codec.valid = false;
+}
+
+// Stamp the header and hand the filling page to the work item; lock held
+static void track_seal(struct track_page *page)
+{
+    uint16_t len = ROUND_UP(page->len, PAGE_ALIGN);
+
+    memset(&page->buf[page->len], 0, len - page->len);
+    page->len = len;
+
+    struct gnss_track_header hdr = 
+    {
+        .magic = GNSS_TRACK_MAGIC,
+        .version = GNSS_TRACK_VERSION,
+        .fixes = page->fixes,
+        .seq = track_seq++,
+        .len = page->len,
+        .crc = 0,
+    };
+
+    memcpy(page->buf, &hdr, sizeof(hdr));
+    hdr.crc = crc16_ccitt(0xFFFF, page->buf, page->len);
+    memcpy(page->buf, &hdr, sizeof(hdr));
+    page->sealed = true;
+    track_fill ^= 1;
+}
+
+static uint32_t track_page_seq(const struct track_page *page)
+{
+    struct gnss_track_header hdr;
+
+    memcpy(&hdr, page->buf, sizeof(hdr));
+    return hdr.seq;
+}
+
+// One FCB entry per page, written with a single flash write
+static int track_commit(const struct track_page *page)
+{
+    struct fcb_entry loc;
+    int rc;
+
+    rc = fcb_append(&track_fcb, page->len, &loc);
+    if (rc == -ENOSPC) 
+    {
+        // Full: erase the oldest sector
+        rc = fcb_rotate(&track_fcb);
+        if (rc == 0) 
+        {
+            rc = fcb_append(&track_fcb, page->len, &loc);
+        }
+    }
+    if (rc != 0) 
+    {
+        return rc;
+    }
+
+    rc = flash_area_write(track_fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), page->buf, page->len);
+    if (rc != 0) 
+    {
+        return rc;
+    }
+    return fcb_append_finish(&track_fcb, &loc);
+}
+
+static void track_work_cb(struct k_work *work)
+{
+    for (;;) 
+    {
+        struct track_page *page = NULL;
+        k_spinlock_key_t key = k_spin_lock(&track_lock);
+
+        // Oldest sealed page first
+        for (int i = 0; i < ARRAY_SIZE(track_pages); i++) 
+        {
+            if (track_pages[i].sealed &&
+                ((page == NULL) || (track_page_seq(&track_pages[i]) < track_page_seq(page)))) 
+            {
+                page = &track_pages[i];
+            }
+        }
+        k_spin_unlock(&track_lock, key);
+
+        if (page == NULL) 
+        {
+            return;
+        }
+
+        int rc = track_commit(page);
+
+        key = k_spin_lock(&track_lock);
+        if (rc != 0) 
+        {
+            track_dropped += page->fixes;
+        }
+        track_page_reset(page);
+        k_spin_unlock(&track_lock, key);
+
+        if (rc != 0) 
+        {
+            LOG_ERR("Track page write failed (%d)", rc);
+        }
+    }
+}
+
+void gnss_track_add(const GNSS_Data *data, const TimeStruct *utc)
+{
+    struct gnss_history_fix fix;
+    struct gnss_history_codec codec;
+    uint8_t entry[GNSS_HISTORY_ENTRY_MAX];
+    struct track_page *page;
+    bool submit = false;
+    size_t len;
+
+    if (!track_ready || !gnss_history_fix_get(&fix, data, utc)) 
+    {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&track_lock);
+
+    page = &track_pages[track_fill];
+    if (!page->sealed) 
+    {
+        codec = page->codec;
+        len = gnss_history_encode(&codec, &fix, page->fixes == 0, entry);
+
+        if ((page->len + len > PAGE_SIZE) || (page->fixes == UINT8_MAX)) 
+        {
+            track_seal(page);
+            submit = true;
+            page = &track_pages[track_fill];
+            codec = page->codec;
+            len = gnss_history_encode(&codec, &fix, true, entry);
+        }
+    }
+
+    if (page->sealed) 
+    {
+        track_dropped++;
+    }
+    else 
+    {
+        memcpy(&page->buf[page->len], entry, len);
+        page->len += len;
+        page->fixes++;
+        page->codec = codec;
+    }
+    k_spin_unlock(&track_lock, key);
+
+    if (submit) 
+    {
+        k_work_submit(&track_work);
+    }
+}
+
+int gnss_track_flush(void)
+{
+    struct k_work_sync sync;
+
+    if (!track_ready) 
+    {
+        return -ENODEV;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&track_lock);
+    struct track_page *page = &track_pages[track_fill];
+
+    if (!page->sealed && (page->fixes > 0)) 
+    {
+        track_seal(page);
+    }
+    k_spin_unlock(&track_lock, key);
+
+    k_work_submit(&track_work);
+    k_work_flush(&track_work, &sync);
+    return 0;
+}
+
+/* Read and check the page at loc; its length, or a negative error if
+ * it is torn or was written by something else */
+static int track_read(struct fcb_entry_ctx *loc_ctx, struct gnss_track_header *hdr)
+{
+    uint16_t len = loc_ctx->loc.fe_data_len;
+    uint16_t crc;
+
+    if ((len < sizeof(*hdr)) || (len > PAGE_SIZE)) 
+    {
+        return -EBADMSG;
+    }
+    if (flash_area_read(loc_ctx->fap, FCB_ENTRY_FA_DATA_OFF(loc_ctx->loc), 
+                        track_read_buf, len) != 0) 
+    {
+        return -EIO;
+    }
+
+    memcpy(hdr, track_read_buf, sizeof(*hdr));
+    crc = hdr->crc;
+    ((struct gnss_track_header *)track_read_buf)->crc = 0;
+    if ((hdr->magic != GNSS_TRACK_MAGIC) || (hdr->version != GNSS_TRACK_VERSION) ||
+        (hdr->len != len) || (crc16_ccitt(0xFFFF, track_read_buf, len) != crc)) 
+    {
+        return -EBADMSG;
+    }
+    ((struct gnss_track_header *)track_read_buf)->crc = crc;
+    return len;
+}
+
+struct track_walk 
+{
+    gnss_track_fix_cb fix_cb;
+    gnss_track_page_cb page_cb;
+    void *user_data;
+    struct gnss_track_usage *usage;
+};
+
+static int track_walk_cb(struct fcb_entry_ctx *loc_ctx, void *arg)
+{
+    struct track_walk *walk = arg;
+    struct gnss_track_header hdr;
+    int len = track_read(loc_ctx, &hdr);
+
+    if (len < 0) 
+    {
+        // Skip it; a reset during the write leaves at most one such page
+        return 0;
+    }
+
+    if (walk->usage != NULL) 
+    {
+        struct gnss_track_usage *usage = walk->usage;
+
+        if (usage->pages == 0) 
+        {
+            usage->first_seq = hdr.seq;
+        }
+        usage->last_seq = hdr.seq;
+        usage->pages++;
+        usage->fixes += hdr.fixes;
+        usage->bytes += len;
+    }
+
+    if (walk->page_cb != NULL) 
+    {
+        return walk->page_cb(track_read_buf, len, walk->user_data);
+    }
+
+    if (walk->fix_cb != NULL) 
+    {
+        struct gnss_history_codec codec = {0};
+        struct gnss_history_fix fix;
+        size_t pos = sizeof(hdr);
+
+        for (int i = 0; i < hdr.fixes; i++) 
+        {
+            size_t used = gnss_history_decode(&codec, &track_read_buf[pos], len - pos, &fix);
+
+            if (used == 0) 
+            {
+                break;
+            }
+            pos += used;
+
+            int rc = walk->fix_cb(&fix, walk->user_data);
+
+            if (rc != 0) 
+            {
+                return rc;
+            }
+        }
+    }
+    return 0;
+}
+
+static int track_walk(struct track_walk *walk)
+{
+    int rc;
+
+    if (!track_ready) 
+    {
+        return -ENODEV;
+    }
+
+    k_mutex_lock(&track_read_lock, K_FOREVER);
+    rc = fcb_walk(&track_fcb, NULL, track_walk_cb, walk);
+    k_mutex_unlock(&track_read_lock);
+    return rc;
+}
+
+int gnss_track_replay(gnss_track_fix_cb cb, void *user_data)
+{
+    struct track_walk walk = { .fix_cb = cb, .user_data = user_data };
+
+    return track_walk(&walk);
+}
+
+int gnss_track_export(gnss_track_page_cb cb, void *user_data)
+{
+    struct track_walk walk = { .page_cb = cb, .user_data = user_data };
+
+    return track_walk(&walk);
+}
+
+void gnss_track_usage(struct gnss_track_usage *usage)
+{
+    struct track_walk walk = { .usage = usage };
+
+    memset(usage, 0, sizeof(*usage));
+    for (int i = 0; i < track_fcb.f_sector_cnt; i++) 
+    {
+        usage->capacity += track_sectors[i].fs_size;
+    }
+    (void)track_walk(&walk);
+
+    k_spinlock_key_t key = k_spin_lock(&track_lock);
+
+    usage->pending = track_pages[0].fixes + track_pages[1].fixes;
+    usage->dropped = track_dropped;
+    k_spin_unlock(&track_lock, key);
+}
+
+static int track_mount(void)
+{
+    track_fcb.f_magic = TRACK_FCB_MAGIC;
+    track_fcb.f_version = GNSS_TRACK_VERSION;
+    track_fcb.f_sectors = track_sectors;
+    track_fcb.f_scratch_cnt = 0;
+    return fcb_init(TRACK_PARTITION_ID, &track_fcb);
+}
+
+static void track_start(struct gnss_track_usage *usage)
+{
+    struct track_walk walk = { .usage = usage };
+
+    track_page_reset(&track_pages[0]);
+    track_page_reset(&track_pages[1]);
+    track_fill = 0;
+    k_work_init(&track_work, track_work_cb);
+    track_ready = true;
+
+    // Number new pages after the newest one that survived the reset
+    (void)track_walk(&walk);
+    track_seq = (usage->pages > 0) ? usage->last_seq + 1 : 0;
+}
+
+static int track_format(void)
+{
+    struct gnss_track_usage usage = {0};
+    const struct flash_area *fa;
+    int rc;
+
+    LOG_WRN("Formatting track partition");
+    rc = flash_area_open(TRACK_PARTITION_ID, &fa);
+    if (rc != 0) 
+    {
+        return rc;
+    }
+    rc = flash_area_erase(fa, 0, flash_area_get_size(fa));
+    flash_area_close(fa);
+    if (rc == 0) 
+    {
+        rc = track_mount();
+    }
+    if (rc != 0) 
+    {
+        LOG_ERR("Track partition mount failed (%d)", rc);
+        return rc;
+    }
+    track_start(&usage);
+    return 0;
+}
+
+int gnss_track_erase(void)
+{
+    struct k_work_sync sync;
+
+    if (!track_ready) 
+    {
+        // Holds something else; only this command may destroy it
+        return (track_fcb.f_sector_cnt > 0) ? track_format() : -ENODEV;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&track_lock);
+
+    for (int i = 0; i < ARRAY_SIZE(track_pages); i++) 
+    {
+        if (!track_pages[i].sealed) 
+        {
+            track_page_reset(&track_pages[i]);
+        }
+    }
+    k_spin_unlock(&track_lock, key);
+
+    // Let a page being written finish before the sectors go
+    k_work_flush(&track_work, &sync);
+    return fcb_clear(&track_fcb);
+}
+
+int gnss_track_init(void)
+{
+    struct gnss_track_usage usage = {0};
+    uint32_t count = ARRAY_SIZE(track_sectors);
+    int rc;
+
+    rc = flash_area_get_sectors(TRACK_PARTITION_ID, &count, track_sectors);
+    if (rc != 0) 
+    {
+        LOG_ERR("Track partition layout unavailable (%d)", rc);
+        return rc;
+    }
+    for (uint32_t i = 0; i < count; i++) 
+    {
+        // FCB adds a sector header and a length and CRC to each entry
+        if (track_sectors[i].fs_size < PAGE_SIZE + 16) 
+        {
+            LOG_ERR("Track page does not fit a %u byte sector",
+                    (uint32_t)track_sectors[i].fs_size);
+            return -EINVAL;
+        }
+    }
+    track_fcb.f_sector_cnt = count;
+
+    // FCB starts a log on a blank partition; anything else is left alone
+    rc = track_mount();
+    if (rc != 0) 
+    {
+        LOG_ERR("Track partition holds no track log (%d), \"gnss track erase\" formats it", rc);
+        return rc;
+    }
+    track_start(&usage);
+    LOG_INF("Track log: %u pages, %u fixes in %u sectors", usage.pages, usage.fixes, count);
+    return 0;
+}
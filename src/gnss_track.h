@@ -0,0 +1,68 @@
+#ifndef _GNSS_TRACK_H_
+#define _GNSS_TRACK_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include "nmea.h"
+#include "gnss_history.h"
+
+/* Persistent track log (CONFIG_LC29H_TRACK). Fixes are collected in a
+ * RAM page and each full page is appended to a flash circular buffer
+ * (FCB) with one write from the system work queue, so the parser never
+ * waits on flash and each sector is written once per fill. When the
+ * partition is full the oldest sector is erased.
+ *
+ * A page is a header followed by history codec entries, the first one
+ * a keyframe, so every page decodes on its own. The header carries a
+ * sequence number and a CRC over the page; FCB adds its own CRC to the
+ * entry. A page cut short by a reset fails both and is skipped. */
+
+#define GNSS_TRACK_MAGIC   0x5447   // "GT"
+#define GNSS_TRACK_VERSION 1
+
+struct gnss_track_header 
+{
+    uint16_t magic;
+    uint8_t version;
+    uint8_t fixes;        // Entries in the page
+    uint32_t seq;         // Page number, increasing across resets
+    uint16_t len;         // Page length, header included
+    uint16_t crc;         // CRC-16/CCITT of the page with this field zero
+} __packed;
+
+struct gnss_track_usage 
+{
+    uint32_t pages;       // Valid pages in flash
+    uint32_t fixes;       // Fixes in those pages
+    uint32_t bytes;       // Bytes in those pages
+    uint32_t capacity;    // Partition size
+    uint32_t first_seq;   // Oldest and newest page stored
+    uint32_t last_seq;
+    uint32_t pending;     // Fixes in RAM, not committed yet
+    uint32_t dropped;     // Fixes lost since boot: flash busy or failing
+};
+
+// Called for each fix (replay) or each raw page (export); non-zero stops the walk
+typedef int (*gnss_track_fix_cb)(const struct gnss_history_fix *fix, void *user_data);
+typedef int (*gnss_track_page_cb)(const uint8_t *page, size_t len, void *user_data);
+
+// Mount the partition; fails if it holds something other than a track log
+int gnss_track_init(void);
+
+// Add the fix of a published epoch (called by the parser)
+void gnss_track_add(const GNSS_Data *data, const TimeStruct *utc);
+
+// Commit the partial page and wait until every page is in flash
+int gnss_track_flush(void);
+
+// Walk stored fixes or pages, oldest first
+int gnss_track_replay(gnss_track_fix_cb cb, void *user_data);
+int gnss_track_export(gnss_track_page_cb cb, void *user_data);
+
+void gnss_track_usage(struct gnss_track_usage *usage);
+
+// Erase the partition and drop the page in RAM; also formats a partition
+// the init refused
+int gnss_track_erase(void);
+
+#endif
@@ -139,7 +139,7 @@ void gps_find_location(GNSS_Data *data)
         double lat = berlinLocations[i].latitude;
         double lon = berlinLocations[i].longitude;
 
-        if (fabs(lat - data->latitude) < 0.0001 && fabs(lon - data->longitude) < 0.0001) 
+        if (fabs(lat - data->latitude / 1e7) < 0.0001 && fabs(lon - data->longitude / 1e7) < 0.0001) 
         {
             printf("Location: %s\n", berlinLocations[i].name);
             return;
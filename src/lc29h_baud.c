@@ -0,0 +1,198 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "nmea.h"
+#include "nmea_cmd.h"
+#include "nmea_tx.h"
+#include "lc29h_baud.h"
+
+LOG_MODULE_REGISTER(lc29h_baud, CONFIG_LOG_DEFAULT_LEVEL);
+
+// Bytes received at the old rate are parsed before counting starts
+#define BAUD_SETTLE_MS 20
+#define BAUD_POLL_MS   100
+#define BAUD_MIN_VALID 2
+
+// Rates the LC29H supports, the factory default first
+static const uint32_t baud_rates[] =
+{
+    115200, 460800, 921600, 230400, 9600, 38400, 57600,
+};
+
+static uint32_t baud_current;
+static K_MUTEX_DEFINE(baud_lock);
+
+/* Noise at a wrong rate still frames the odd '$'...'\n', but almost
+ * never with a matching checksum; a right rate gives a burst of good
+ * sentences every fix interval. */
+static bool baud_probe(void)
+{
+    uint32_t valid0, invalid0, valid, invalid;
+    int64_t end;
+
+    k_msleep(BAUD_SETTLE_MS);
+    nmea_link_counts(&valid0, &invalid0);
+    end = k_uptime_get() + CONFIG_LC29H_BAUD_PROBE_MS;
+
+    do
+    {
+        k_msleep(BAUD_POLL_MS);
+        nmea_link_counts(&valid, &invalid);
+        valid -= valid0;
+        invalid -= invalid0;
+        if ((valid >= BAUD_MIN_VALID) && (valid > invalid))
+        {
+            return true;
+        }
+    } while (k_uptime_get() < end);
+
+    return false;
+}
+
+static bool baud_try(uint32_t baud)
+{
+    int ret = nmea_tx_set_baud(baud);
+
+    if (ret != 0)
+    {
+        LOG_WRN("UART rejected %u baud (%d)", baud, ret);
+        return false;
+    }
+    return baud_probe();
+}
+
+static int baud_detect(uint32_t first)
+{
+    if (baud_try(first))
+    {
+        baud_current = first;
+        return first;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(baud_rates); i++)
+    {
+        if ((baud_rates[i] != first) && baud_try(baud_rates[i]))
+        {
+            LOG_INF("Receiver found at %u baud", baud_rates[i]);
+            baud_current = baud_rates[i];
+            return baud_rates[i];
+        }
+    }
+
+    LOG_ERR("No NMEA at any baud rate");
+    nmea_tx_set_baud(first);
+    return -EIO;
+}
+
+static int baud_switch(uint32_t baud)
+{
+    char body[sizeof(LC29H_SET_BAUD) + 8];
+    uint32_t old = baud_current;
+    int ret;
+
+    if (baud == old)
+    {
+        return 0;
+    }
+
+    // The receiver answers at the old rate, then switches; a lost ACK
+    // may still mean it switched, so only a refusal stops here
+    snprintk(body, sizeof(body), LC29H_SET_BAUD, baud);
+    ret = nmea_cmd_send(body);
+    if ((ret != 0) && (ret != -ETIMEDOUT))
+    {
+        LOG_ERR("Receiver refused %u baud (%d)", baud, ret);
+        return ret;
+    }
+
+    if (baud_try(baud))
+    {
+        baud_current = baud;
+        LOG_INF("Link at %u baud", baud);
+        return 0;
+    }
+
+    LOG_WRN("No valid sentences at %u baud, falling back to %u", baud, old);
+    if (baud_try(old))
+    {
+        // The receiver never left the old rate
+        return -EIO;
+    }
+
+    /* The receiver switched but the line does not carry the new rate.
+     * Its input may still work: ask it back without waiting for an ACK
+     * we cannot read, then search for it if that did not help. */
+    snprintk(body, sizeof(body), LC29H_SET_BAUD, old);
+    if ((nmea_tx_set_baud(baud) == 0) && (send_nmea_message(body) == 0))
+    {
+        nmea_tx_flush(K_MSEC(100));
+    }
+    if (baud_try(old))
+    {
+        return -EIO;
+    }
+
+    ret = baud_detect(old);
+    return (ret < 0) ? ret : -EIO;
+}
+
+int lc29h_baud_detect(void)
+{
+    uint32_t first;
+    int ret;
+
+    ret = nmea_tx_get_baud(&first);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    k_mutex_lock(&baud_lock, K_FOREVER);
+    ret = baud_detect(first);
+    k_mutex_unlock(&baud_lock);
+    return ret;
+}
+
+int lc29h_baud_set(uint32_t baud)
+{
+    int ret;
+
+    k_mutex_lock(&baud_lock, K_FOREVER);
+    if (baud_current == 0)
+    {
+        k_mutex_unlock(&baud_lock);
+        return -EIO;
+    }
+    ret = baud_switch(baud);
+    k_mutex_unlock(&baud_lock);
+    return ret;
+}
+
+uint32_t lc29h_baud_get(void)
+{
+    return baud_current;
+}
+
+int lc29h_baud_init(void)
+{
+    int64_t start = k_uptime_get();
+    int ret;
+
+    ret = lc29h_baud_detect();
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    if (CONFIG_LC29H_BAUD_TARGET != 0)
+    {
+        ret = lc29h_baud_set(CONFIG_LC29H_BAUD_TARGET);
+        if (ret < 0)
+        {
+            LOG_WRN("Staying at %u baud (%d)", baud_current, ret);
+        }
+    }
+
+    LOG_INF("Receiver link at %u baud after %u ms", baud_current,
+            (uint32_t)(k_uptime_get() - start));
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef _LC29H_BAUD_H_
+#define _LC29H_BAUD_H_
+
+#include <inttypes.h>
+
+/* UART baud management (CONFIG_LC29H_BAUD). The receiver streams NMEA
+ * as soon as it boots, so a rate is right when sentences with good
+ * checksums arrive at it. Detection tries the host's current rate, then
+ * every rate the LC29H supports; a switch sends PAIR864, moves the host
+ * UART and keeps the new rate only if sentences still check out. */
+
+// Detect, then move both sides to CONFIG_LC29H_BAUD_TARGET if set
+int lc29h_baud_init(void);
+
+// Find the receiver's rate and set the host UART to it; the rate or -EIO
+int lc29h_baud_detect(void);
+
+/* Switch the receiver and the host to baud and verify the link. On
+ * failure both sides are back at the previous rate and -EIO is
+ * returned. */
+int lc29h_baud_set(uint32_t baud);
+
+// Rate of the verified link, 0 before detection
+uint32_t lc29h_baud_get(void);
+
+#endif
@@ -0,0 +1,297 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <stdarg.h>
+#include <string.h>
+#include "nmea.h"
+#include "nmea_scan.h"
+#include "nmea_cmd.h"
+#include "nmea_tx.h"
+#include "lc29h_config.h"
+#ifdef CONFIG_LC29H_BAUD
+#include "lc29h_baud.h"
+#endif
+
+LOG_MODULE_REGISTER(lc29h_config, CONFIG_LOG_DEFAULT_LEVEL);
+
+#define CONFIG_CMD_MAX (LC29H_SENTENCE_COUNT + 4)
+#define CONFIG_BODY_LEN 40
+
+// Settings reported by the receiver, filled in by the query callbacks
+static struct 
+{
+    uint32_t known;          // LC29H_PROFILE_* answered
+    uint8_t rates[LC29H_SENTENCE_COUNT];
+    uint16_t fix_interval_ms;
+    uint8_t constellations;
+    uint32_t baud;
+} config_state;
+
+static struct nmea_cmd config_cmds[CONFIG_CMD_MAX];
+static char config_bodies[CONFIG_CMD_MAX][CONFIG_BODY_LEN];
+static K_MUTEX_DEFINE(config_lock);
+
+void lc29h_profile_init(struct lc29h_profile *profile)
+{
+    memset(profile, 0, sizeof(*profile));
+}
+
+void lc29h_profile_sentence(struct lc29h_profile *profile, enum lc29h_sentence sentence,
+                            uint8_t rate)
+{
+    profile->rates[sentence] = rate;
+    profile->set |= LC29H_PROFILE_SENTENCE(sentence);
+}
+
+void lc29h_profile_fix_interval(struct lc29h_profile *profile, uint16_t interval_ms)
+{
+    profile->fix_interval_ms = interval_ms;
+    profile->set |= LC29H_PROFILE_FIX_INTERVAL;
+}
+
+void lc29h_profile_constellations(struct lc29h_profile *profile, uint8_t constellations)
+{
+    profile->constellations = constellations;
+    profile->set |= LC29H_PROFILE_CONSTELLATIONS;
+}
+
+void lc29h_profile_pps(struct lc29h_profile *profile, uint8_t mode, uint16_t width_ms)
+{
+    profile->pps_mode = mode;
+    profile->pps_width_ms = width_ms;
+    profile->set |= LC29H_PROFILE_PPS;
+}
+
+void lc29h_profile_baud(struct lc29h_profile *profile, uint32_t baud)
+{
+    profile->baud = baud;
+    profile->set |= LC29H_PROFILE_BAUD;
+}
+
+void lc29h_profile_default(struct lc29h_profile *profile)
+{
+    lc29h_profile_init(profile);
+
+    // Sentences without a parser only cost UART bandwidth
+    lc29h_profile_sentence(profile, LC29H_GGA, IS_ENABLED(CONFIG_LC29H_NMEA_GGA));
+    lc29h_profile_sentence(profile, LC29H_GLL, IS_ENABLED(CONFIG_LC29H_NMEA_GLL));
+    lc29h_profile_sentence(profile, LC29H_GSA, IS_ENABLED(CONFIG_LC29H_NMEA_GSA));
+    lc29h_profile_sentence(profile, LC29H_GSV, IS_ENABLED(CONFIG_LC29H_NMEA_GSV));
+    lc29h_profile_sentence(profile, LC29H_RMC, IS_ENABLED(CONFIG_LC29H_NMEA_RMC));
+    lc29h_profile_sentence(profile, LC29H_VTG, IS_ENABLED(CONFIG_LC29H_NMEA_VTG));
+    lc29h_profile_sentence(profile, LC29H_ZDA, IS_ENABLED(CONFIG_LC29H_NMEA_ZDA));
+    lc29h_profile_sentence(profile, LC29H_GRS, IS_ENABLED(CONFIG_LC29H_NMEA_GRS));
+    lc29h_profile_sentence(profile, LC29H_GST, IS_ENABLED(CONFIG_LC29H_NMEA_GST));
+
+    if (CONFIG_LC29H_FIX_INTERVAL_MS != 0) 
+    {
+        lc29h_profile_fix_interval(profile, CONFIG_LC29H_FIX_INTERVAL_MS);
+    }
+}
+
+static bool config_field_uint(const NMEA_Fields *fields, uint8_t field, uint32_t *value)
+{
+    return (field < fields->count) &&
+           nmea_scan_uint(NMEA_FIELD(fields, field), fields->len[field], value);
+}
+
+// Query answers, from the parser
+static void config_query_cb(struct nmea_cmd *cmd, int result, const NMEA_Fields *response)
+{
+    const char *addr;
+    uint32_t value;
+    uint32_t type;
+
+    if ((result != 0) || (response == NULL) || (response->len[0] != 7)) 
+    {
+        return;
+    }
+    addr = NMEA_FIELD(response, 0);
+
+    if ((memcmp(addr, "PAIR063", 7) == 0) && config_field_uint(response, 1, &type) &&
+        (type < LC29H_SENTENCE_COUNT) && config_field_uint(response, 2, &value)) 
+    {
+        config_state.rates[type] = value;
+        config_state.known |= LC29H_PROFILE_SENTENCE(type);
+    }
+    else if ((memcmp(addr, "PAIR051", 7) == 0) && config_field_uint(response, 1, &value)) 
+    {
+        config_state.fix_interval_ms = value;
+        config_state.known |= LC29H_PROFILE_FIX_INTERVAL;
+    }
+    else if (memcmp(addr, "PAIR067", 7) == 0) 
+    {
+        config_state.constellations = 0;
+        for (uint8_t i = 0; i < 5; i++) 
+        {
+            if (config_field_uint(response, i + 1, &value) && (value != 0)) 
+            {
+                config_state.constellations |= BIT(i);
+            }
+        }
+        config_state.known |= LC29H_PROFILE_CONSTELLATIONS;
+    }
+    else if ((memcmp(addr, "PAIR865", 7) == 0) && config_field_uint(response, 1, &value)) 
+    {
+        config_state.baud = value;
+        config_state.known |= LC29H_PROFILE_BAUD;
+    }
+}
+
+static void config_prepare(int index, bool query, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintk(config_bodies[index], CONFIG_BODY_LEN, fmt, args);
+    va_end(args);
+
+    nmea_cmd_init(&config_cmds[index], config_bodies[index], query ? config_query_cb : NULL, NULL);
+    config_cmds[index].query = query;
+}
+
+/* Send the prepared commands back to back and wait for all of them.
+ * Returns the first error. */
+static int config_run(int count)
+{
+    bool submitted[CONFIG_CMD_MAX];
+    int ret = 0;
+
+    for (int i = 0; i < count; i++) 
+    {
+        int err = nmea_cmd_submit(&config_cmds[i]);
+
+        if (err == -ENOBUFS) 
+        {
+            // More commands than TX buffers: let the queue drain
+            nmea_tx_flush(K_MSEC(CONFIG_LC29H_CMD_TIMEOUT_MS));
+            err = nmea_cmd_submit(&config_cmds[i]);
+        }
+        submitted[i] = (err == 0);
+        if ((err != 0) && (ret == 0)) 
+        {
+            ret = err;
+        }
+    }
+
+    for (int i = 0; i < count; i++) 
+    {
+        if (submitted[i]) 
+        {
+            int err = nmea_cmd_wait(&config_cmds[i], K_FOREVER);
+
+            if ((err != 0) && (ret == 0)) 
+            {
+                ret = err;
+            }
+        }
+    }
+    return ret;
+}
+
+// Setting in the profile that the receiver did not report as already applied
+static bool config_differs(const struct lc29h_profile *profile, uint32_t setting, bool equal)
+{
+    return (profile->set & setting) && !((config_state.known & setting) && equal);
+}
+
+int lc29h_config_apply(const struct lc29h_profile *profile, bool save)
+{
+    int64_t start = k_uptime_get();
+    int changes = 0;
+    int count = 0;
+    int ret;
+
+    k_mutex_lock(&config_lock, K_FOREVER);
+    memset(&config_state, 0, sizeof(config_state));
+
+    // Current state, all queries in flight at once; unanswered ones are sent anyway
+    for (int s = 0; s < LC29H_SENTENCE_COUNT; s++) 
+    {
+        if (profile->set & LC29H_PROFILE_SENTENCE(s)) 
+        {
+            config_prepare(count++, true, "PAIR063,%d", s);
+        }
+    }
+    if (profile->set & LC29H_PROFILE_FIX_INTERVAL) 
+    {
+        config_prepare(count++, true, "PAIR051");
+    }
+    if (profile->set & LC29H_PROFILE_CONSTELLATIONS) 
+    {
+        config_prepare(count++, true, "PAIR067");
+    }
+    if (profile->set & LC29H_PROFILE_BAUD) 
+    {
+        config_prepare(count++, true, "PAIR865,0,0");
+    }
+    (void)config_run(count);
+
+    // Only the differences, again back to back
+    count = 0;
+    for (int s = 0; s < LC29H_SENTENCE_COUNT; s++) 
+    {
+        if (config_differs(profile, LC29H_PROFILE_SENTENCE(s),
+                           config_state.rates[s] == profile->rates[s])) 
+        {
+            config_prepare(count++, false, "PAIR062,%d,%u", s, profile->rates[s]);
+        }
+    }
+    if (config_differs(profile, LC29H_PROFILE_FIX_INTERVAL,
+                       config_state.fix_interval_ms == profile->fix_interval_ms)) 
+    {
+        config_prepare(count++, false, "PAIR050,%u", profile->fix_interval_ms);
+    }
+    if (config_differs(profile, LC29H_PROFILE_CONSTELLATIONS,
+                       config_state.constellations == profile->constellations)) 
+    {
+        uint8_t gnss = profile->constellations;
+
+        config_prepare(count++, false, "PAIR066,%u,%u,%u,%u,%u,0",
+                       !!(gnss & LC29H_GNSS_GPS), !!(gnss & LC29H_GNSS_GLONASS),
+                       !!(gnss & LC29H_GNSS_GALILEO), !!(gnss & LC29H_GNSS_BEIDOU),
+                       !!(gnss & LC29H_GNSS_QZSS));
+    }
+    if (profile->set & LC29H_PROFILE_PPS) 
+    {
+        // No query for the PPS setting; always sent
+        config_prepare(count++, false, "PAIR752,%u,%u", profile->pps_mode, profile->pps_width_ms);
+    }
+    changes = count;
+    ret = config_run(count);
+
+    // Baud rate last: the receiver switches after its ACK, then so do we
+    if ((ret == 0) && config_differs(profile, LC29H_PROFILE_BAUD,
+                                     config_state.baud == profile->baud)) 
+    {
+#ifdef CONFIG_LC29H_BAUD
+        // Verified switch that falls back to the old rate
+        ret = lc29h_baud_set(profile->baud);
+#else
+        config_prepare(0, false, LC29H_SET_BAUD, profile->baud);
+        ret = config_run(1);
+        if (ret == 0) 
+        {
+            ret = nmea_tx_set_baud(profile->baud);
+        }
+#endif
+        if (ret == 0) 
+        {
+            changes++;
+        }
+    }
+
+    if ((ret == 0) && save && (changes > 0)) 
+    {
+        config_prepare(0, false, LC29H_SAVE_CFG);
+        ret = config_run(1);
+    }
+    k_mutex_unlock(&config_lock);
+
+    if (ret != 0) 
+    {
+        LOG_ERR("Receiver profile failed (%d)", ret);
+        return ret;
+    }
+    LOG_INF("Receiver profile: %d changes in %u ms", changes, (uint32_t)(k_uptime_get() - start));
+    return changes;
+}
@@ -0,0 +1,77 @@
+#ifndef _LC29H_CONFIG_H_
+#define _LC29H_CONFIG_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <zephyr/sys/util.h>
+
+/* Receiver configuration profile (CONFIG_LC29H_CONFIG). A profile lists
+ * only the settings the application cares about; lc29h_config_apply()
+ * queries those from the receiver, sends only the ones that differ, all
+ * back to back, and saves them with PQTMSAVEPAR.
+ *
+ *     struct lc29h_profile profile;
+ *
+ *     lc29h_profile_init(&profile);
+ *     lc29h_profile_sentence(&profile, LC29H_GGA, 1);
+ *     lc29h_profile_sentence(&profile, LC29H_GSV, 5);
+ *     lc29h_profile_fix_interval(&profile, 200);
+ *     lc29h_config_apply(&profile, true);
+ */
+
+// PAIR062 sentence types
+enum lc29h_sentence 
+{
+    LC29H_GGA = 0,
+    LC29H_GLL,
+    LC29H_GSA,
+    LC29H_GSV,
+    LC29H_RMC,
+    LC29H_VTG,
+    LC29H_ZDA,
+    LC29H_GRS,
+    LC29H_GST,
+    LC29H_SENTENCE_COUNT
+};
+
+// PAIR066 constellations
+#define LC29H_GNSS_GPS      BIT(0)
+#define LC29H_GNSS_GLONASS  BIT(1)
+#define LC29H_GNSS_GALILEO  BIT(2)
+#define LC29H_GNSS_BEIDOU   BIT(3)
+#define LC29H_GNSS_QZSS     BIT(4)
+
+struct lc29h_profile 
+{
+    uint32_t set;            // LC29H_PROFILE_* of the settings given
+    uint8_t rates[LC29H_SENTENCE_COUNT];  // Output every Nth fix, 0 = off
+    uint16_t fix_interval_ms;
+    uint8_t constellations;  // LC29H_GNSS_*
+    uint8_t pps_mode;        // PAIR752 type, 0 = off
+    uint16_t pps_width_ms;
+    uint32_t baud;
+};
+
+#define LC29H_PROFILE_SENTENCE(s)      BIT(s)
+#define LC29H_PROFILE_FIX_INTERVAL     BIT(LC29H_SENTENCE_COUNT)
+#define LC29H_PROFILE_CONSTELLATIONS   BIT(LC29H_SENTENCE_COUNT + 1)
+#define LC29H_PROFILE_PPS              BIT(LC29H_SENTENCE_COUNT + 2)
+#define LC29H_PROFILE_BAUD             BIT(LC29H_SENTENCE_COUNT + 3)
+
+// Builder: start empty, then add the settings to enforce
+void lc29h_profile_init(struct lc29h_profile *profile);
+void lc29h_profile_sentence(struct lc29h_profile *profile, enum lc29h_sentence sentence,
+                            uint8_t rate);
+void lc29h_profile_fix_interval(struct lc29h_profile *profile, uint16_t interval_ms);
+void lc29h_profile_constellations(struct lc29h_profile *profile, uint8_t constellations);
+void lc29h_profile_pps(struct lc29h_profile *profile, uint8_t mode, uint16_t width_ms);
+void lc29h_profile_baud(struct lc29h_profile *profile, uint32_t baud);
+
+// The profile of this build: the sentences enabled in Kconfig, and the fix interval
+void lc29h_profile_default(struct lc29h_profile *profile);
+
+/* Bring the receiver in line with profile. Returns the number of
+ * settings changed, or a negative errno if one could not be applied. */
+int lc29h_config_apply(const struct lc29h_profile *profile, bool save);
+
+#endif
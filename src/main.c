@@ -1,3 +1,4 @@
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/uart.h>
 #include <zephyr/drivers/gpio.h>
@@ -5,36 +6,82 @@
 #include <zephyr/sys/ring_buffer.h>
 #include "shellnmea.h"
 #include "nmea.h"
+#include "nmea_framer.h"
+#include "gnss_stats.h"
+#include "gnss_governor.h"
+#include "nmea_tx.h"
+#ifdef CONFIG_LC29H_BAUD
+#include "lc29h_baud.h"
+#endif
+#ifdef CONFIG_LC29H_CONFIG
+#include "lc29h_config.h"
+#endif
+#ifdef CONFIG_LC29H_NMEA_BENCH
+#include "nmea_bench.h"
+#endif
+#ifdef CONFIG_LC29H_NMEA_FUZZ
+#include "nmea_fuzz.h"
+#endif
+#ifdef CONFIG_LC29H_TRACK
+#include "gnss_track.h"
+#endif
 
 #define RESET_PIN  23
 #define WAKEUP_PIN 24
 #define VCC_PIN    25
-#define SENTENCE_MAX_LEN 128
-#define TX_TIMEOUT_MS 1000 
 
 LOG_MODULE_REGISTER(main, CONFIG_LOG_DEFAULT_LEVEL);
 
 const struct device *gpio0_dev = DEVICE_DT_GET(DT_NODELABEL(gpio0));
 static const struct device *const uart_dev = DEVICE_DT_GET(DT_NODELABEL(uart0));
 static const struct device *const uart_dev1 = DEVICE_DT_GET(DT_NODELABEL(uart1));
-static char sentence[SENTENCE_MAX_LEN];
-static uint16_t sentence_idx = 0;
-static volatile bool tx_done = false;
-
-// Work queue and work item
-K_THREAD_STACK_DEFINE(gnss_work_q_stack, 1024);
-struct k_work_q gnss_work_q;
-struct k_work gnss_work;
 
 // Ring buffer for thread-safe data transfer
 RING_BUF_DECLARE(gnss_ring_buf, 256);
 
+// Wakes the parser thread, once per received chunk or line
+static K_SEM_DEFINE(gnss_rx_sem, 0, 1);
+
+static void gnss_parser_fn(void *p1, void *p2, void *p3);
+K_THREAD_DEFINE(gnss_parser, CONFIG_LC29H_PARSER_STACK_SIZE, gnss_parser_fn, NULL, NULL, NULL,
+                CONFIG_LC29H_PARSER_PRIORITY, 0, SYS_FOREVER_MS);
+
+#ifdef CONFIG_LC29H_RX_ASYNC
+// DMA buffers handed to the UART driver in turn
+static uint8_t rx_dma_buf[2][CONFIG_LC29H_RX_BUF_SIZE];
+static uint8_t rx_dma_next;
+#endif
+
+#ifdef CONFIG_LC29H_RX_PROFILE
+static struct gnss_rx_profile rx_profile;
+
+#define RX_PROFILE_START()     uint32_t _rx_start = k_cycle_get_32()
+#define RX_PROFILE_END(field)  (rx_profile.field += k_cycle_get_32() - _rx_start)
+#define RX_PROFILE_INC(field)  (rx_profile.field++)
+
+void gnss_rx_profile_get(struct gnss_rx_profile *profile, bool reset)
+{
+    unsigned int key = irq_lock();
+
+    *profile = rx_profile;
+    if (reset)
+    {
+        memset(&rx_profile, 0, sizeof(rx_profile));
+    }
+    irq_unlock(key);
+}
+#else
+#define RX_PROFILE_START()
+#define RX_PROFILE_END(field)
+#define RX_PROFILE_INC(field)
+#endif
+
 #ifdef NMEA_TEST 
 // Checksum calculation
 static bool verify_nmea_checksum(const char *sentence)
 {
     const char *asterisk = strchr(sentence, '*');
-    if (!asterisk || asterisk - sentence > SENTENCE_MAX_LEN - 3) 
+    if (!asterisk || asterisk - sentence > NMEA_SENTENCE_MAX_LEN - 3) 
     {
         return false;
     }
@@ -103,37 +150,58 @@ static void initialize_gps_module(void)
     k_msleep(500);  // Wait for module to boot
 }
 
-static void gnss_work_cb(struct k_work *work)
+// Receive context; a parser that is already awake runs once more at most
+static inline void gnss_parser_wake(void)
 {
-    uint8_t data;
-    size_t len;
+    if (k_sem_count_get(&gnss_rx_sem) == 0) 
+    {
+        gnss_governor_queued();
+    }
+    k_sem_give(&gnss_rx_sem);
+    RX_PROFILE_INC(parser_wakeups);
+}
+
+/* Frames and parses whatever the receive path left in the ring. With a
+ * budget, a pass that uses it up sleeps a tick before the next one so
+ * lower priority threads are not starved by a burst. */
+static void gnss_parser_fn(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+    const uint32_t budget = k_us_to_cyc_ceil32(CONFIG_LC29H_PARSER_BUDGET_US);
 
-    while ((len = ring_buf_get(&gnss_ring_buf, &data, 1)) == 1) 
+    while (true) 
     {
-        if (data == '$') 
-        {
-            // Start of new sentence
-            sentence_idx = 0;
-            sentence[sentence_idx++] = data;
-        }
-        else if ((sentence_idx > 0) && (sentence_idx < SENTENCE_MAX_LEN - 1))
+        k_sem_take(&gnss_rx_sem, K_FOREVER);
+        gnss_governor_run();
+
+        uint32_t start = k_cycle_get_32();
+        uint32_t count = nmea_framer_process(&gnss_ring_buf, budget);
+        uint32_t cycles = k_cycle_get_32() - start;
+
+#ifdef CONFIG_LC29H_RX_PROFILE
+        rx_profile.parser_runs++;
+        rx_profile.sentences += count;
+        rx_profile.parse_cycles += cycles;
+#else
+        ARG_UNUSED(count);
+#endif
+        if ((budget != 0) && (cycles >= budget)) 
         {
-            sentence[sentence_idx++] = data;
-            
-            // Check for complete sentence
-            if (data == '\n') 
-            {
-                sentence[sentence_idx] = '\0';
-                nmea_processing(sentence);
-                sentence_idx = 0;
-            }
+            RX_PROFILE_INC(budget_stops);
+            k_sleep(K_TICKS(1));
+            k_sem_give(&gnss_rx_sem);
         }
     }
 }
 
+#ifdef CONFIG_LC29H_RX_IRQ
 static void uart_isr(const struct device *dev, void *user_data)
 {
     ARG_UNUSED(user_data);
+    RX_PROFILE_START();
+    RX_PROFILE_INC(isr_entries);
 
     if (!uart_irq_update(dev)) return;
 
@@ -142,63 +210,97 @@ static void uart_isr(const struct device *dev, void *user_data)
         uint8_t byte;
         if (uart_fifo_read(dev, &byte, 1) == 1) 
         {
-            if (ring_buf_put(&gnss_ring_buf, &byte, 1) != 1) 
+            uint32_t put = ring_buf_put(&gnss_ring_buf, &byte, 1);
+            uint32_t used = ring_buf_size_get(&gnss_ring_buf);
+
+            gnss_stats_rx(&byte, 1, put, used);
+            gnss_governor_rx(used, 1 - put);
+            if (put != 1) 
             {
                 LOG_WRN("Ring buffer full!");
             }
-            k_work_submit_to_queue(&gnss_work_q, &gnss_work);
+            // One wakeup per line, or earlier if the line is long
+            if ((byte == '\n') || (used >= ring_buf_capacity_get(&gnss_ring_buf) / 2)) 
+            {
+                gnss_parser_wake();
+            }
         }
     }
-}
 
-int send_nmea_message(const char *sentence)
-{
-    if (!device_is_ready(uart_dev)) 
+    if (uart_irq_tx_ready(dev)) 
     {
-        LOG_ERR("UART device not ready\n");
-        return -ENODEV;
+        nmea_tx_isr(dev);
     }
+    RX_PROFILE_END(isr_cycles);
+}
+#endif
 
-#ifdef NMEA_TEST
-    size_t len = strlen(sentence);
-    int ret;
-    int attempts = 0;
-    const int max_attempts = 3;
+#ifdef CONFIG_LC29H_RX_ASYNC
+static int uart_rx_start(const struct device *dev)
+{
+    int ret = uart_rx_enable(dev, rx_dma_buf[rx_dma_next], sizeof(rx_dma_buf[0]),
+                             CONFIG_LC29H_RX_TIMEOUT_US);
+    rx_dma_next ^= 1;
+    return ret;
+}
+
+static void uart_async_cb(const struct device *dev, struct uart_event *evt, void *user_data)
+{
+    ARG_UNUSED(user_data);
+    RX_PROFILE_START();
+    RX_PROFILE_INC(isr_entries);
 
-    while (attempts < max_attempts) 
+    switch (evt->type) 
     {
-        // Convert timeout to milliseconds as expected by uart_tx
-        ret = uart_tx(uart_dev, (const uint8_t *)sentence, len, TX_TIMEOUT_MS);
-        
-        if (ret == 0) 
+        case UART_RX_RDY:
         {
-            LOG_INF("TX successful: %s", sentence);
-            tx_done = true;
-            return 0;
-        }
-        
-        k_sleep(K_MSEC(100));  // Short delay between attempts
-        attempts++;
-    }
-    LOG_ERR("Failed to send after %d attempts error: %d", max_attempts, ret);
-    return -EIO;
-#else
-    for (int i = 0; sentence[i] != '\0'; i++) 
-    {
-        char ch = sentence[i];
-        uart_poll_out(uart_dev, ch);
+            // Whole chunk goes to the parser in one copy and one wakeup
+            const uint8_t *chunk = evt->data.rx.buf + evt->data.rx.offset;
+            uint32_t put = ring_buf_put(&gnss_ring_buf, chunk, evt->data.rx.len);
+            uint32_t used = ring_buf_size_get(&gnss_ring_buf);
 
-        if (sentence[i] == '\n') 
-        {
-            return 0;
+            gnss_stats_rx(chunk, evt->data.rx.len, put, used);
+            gnss_governor_rx(used, evt->data.rx.len - put);
+            if (put != evt->data.rx.len) 
+            {
+                LOG_WRN("Ring buffer full!");
+            }
+            gnss_parser_wake();
         }
+        break;
+        case UART_RX_BUF_REQUEST:
+            uart_rx_buf_rsp(dev, rx_dma_buf[rx_dma_next], sizeof(rx_dma_buf[0]));
+            rx_dma_next ^= 1;
+        break;
+        case UART_RX_DISABLED:
+            // The driver stops on line errors (framing, break); restart it
+            if (uart_rx_start(dev) != 0) 
+            {
+                LOG_ERR("Failed to restart UART RX");
+            }
+        break;
+        case UART_RX_STOPPED:
+            LOG_WRN("UART RX stopped, reason %d", evt->data.rx_stop.reason);
+        break;
+        case UART_TX_DONE:
+        case UART_TX_ABORTED:
+            nmea_tx_async_event(evt);
+        break;
+        default:
+        break;
     }
-#endif
-    return 0;
+    RX_PROFILE_END(isr_cycles);
 }
+#endif
 
 int main(void)
 {
+#ifdef CONFIG_LC29H_NMEA_FUZZ
+    // No receiver: libFuzzer inputs are the only data
+    nmea_init();
+    nmea_fuzz_run();
+#endif
+
     print_xtracker();
 
     initialize_gps_module();
@@ -216,31 +318,54 @@ int main(void)
     }
     
     nmea_init();
+    nmea_tx_init(uart_dev);
+
+#ifdef CONFIG_LC29H_TRACK
+    // Without flash the receiver still runs, only nothing is logged
+    gnss_track_init();
+#endif
+
+#ifdef CONFIG_LC29H_NMEA_BENCH
+    nmea_bench_run();
+#endif
     
-    // Initialize work queue
-    k_work_queue_init(&gnss_work_q);
-    k_work_queue_start(&gnss_work_q, gnss_work_q_stack,
-                      K_THREAD_STACK_SIZEOF(gnss_work_q_stack),
-                      CONFIG_MAIN_THREAD_PRIORITY, NULL);
-    k_work_init(&gnss_work, gnss_work_cb);
+    // Parser first, so nothing received waits for it
+    k_thread_start(gnss_parser);
 
+#ifdef CONFIG_LC29H_RX_ASYNC
+    // Setup UART DMA reception
+    uart_callback_set(uart_dev, uart_async_cb, NULL);
+    if (uart_rx_start(uart_dev) != 0) 
+    {
+        LOG_ERR("Failed to enable UART RX");
+        return 0;
+    }
+#else
     // Setup UART interrupt
     uart_irq_callback_user_data_set(uart_dev, uart_isr, NULL);
     uart_irq_rx_enable(uart_dev);
+#endif
     
+#ifdef CONFIG_LC29H_BAUD
+    // Commands only get through once both sides agree on the rate
+    lc29h_baud_init();
+#endif
+
+#ifdef CONFIG_LC29H_CONFIG
+    // The parser is running now, so the answers are seen
+    struct lc29h_profile profile;
+
+    lc29h_profile_default(&profile);
+    lc29h_config_apply(&profile, IS_ENABLED(CONFIG_LC29H_CONFIG_SAVE));
+#endif
+
+#ifdef CONFIG_LC29H_GOVERNOR
+    // Starts from the profile rates just applied
+    gnss_governor_init(ring_buf_capacity_get(&gnss_ring_buf));
+#endif
+
 #ifdef NMEA_TEST 
-    send_nmea_message("$PQTMVER*58\r\n");
-    send_nmea_message("$PAIR062,1,1*3F\r\n");
-    send_nmea_message("$PAIR062,2,1*3C\r\n");
-    send_nmea_message("$PAIR062,3,1*3D\r\n");
-    send_nmea_message("$PAIR062,4,1*3A\r\n");
-    send_nmea_message("$PAIR062,5,1*3B\r\n");
-                   
-    if(tx_done == true)
-    {
-        send_nmea_message("$PQTMRESTOREPAR*13\r\n");
-        tx_done = false;
-    }
+    send_nmea_message(LC29H_VERNO_CMD);
 
     while (1) 
     {
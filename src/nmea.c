@@ -3,411 +3,545 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/kernel.h>
 #include <string.h>
-#include <math.h>
 #include "nmea.h"
+#include "nmea_scan.h"
+#include "gnss_stats.h"
+#ifdef CONFIG_LC29H_NOTIFY
+#include "gnss_notify.h"
+#endif
+#ifdef CONFIG_LC29H_HISTORY
+#include "gnss_history.h"
+#endif
+#ifdef CONFIG_LC29H_TRACK
+#include "gnss_track.h"
+#endif
+#ifdef CONFIG_LC29H_CMD
+#include "nmea_cmd.h"
+#endif
+#ifdef CONFIG_LC29H_NMEA_GSV
+#include "gnss_sats.h"
+#endif
 
-GNSS_Data *gnss_data = NULL;
-TimeStruct UTC_time = {0};
+// Private working record, only touched by the parser
+static GNSS_Data gnss_data;
+static TimeStruct UTC_time = {0};
+
+// Receiver information, rarely written; the lock keeps the string whole
+static GNSS_Info gnss_info;
+static struct k_spinlock gnss_info_lock;
+
+// Sentences that passed and failed tokenizing; word sized, read unlocked
+static uint32_t link_valid;
+static uint32_t link_invalid;
+
+#ifdef CONFIG_LC29H_NMEA_BENCH
+// Benchmark replay running: its epochs must not leave the parser
+static bool gnss_isolated;
+#else
+#define gnss_isolated false
+#endif
+
+/* Published snapshots, a seqlock with two copies (latch): the writer
+ * updates one copy while readers are steered to the other by the low bit
+ * of the sequence, so a reader never waits and never sees a torn fix. */
+static GNSS_Snapshot gnss_published[2];
+static atomic_t gnss_seq = ATOMIC_INIT(0);
+
+/* Epoch being assembled. The receiver sends GGA, RMC, GSA, GSV, VTG ...
+ * of one fix back to back; they are merged into the working record and
+ * published once, when the next fix starts or the configured last
+ * sentence (CONFIG_LC29H_EPOCH_LAST) arrives. */
+static struct 
+{
+    uint32_t time_ms;     // UTC time of the epoch, ms since midnight
+    bool timed;           // time_ms was seen in this epoch
+    uint32_t sentences;   // BIT(NMEA_MessageType) collected so far
+    uint32_t count;       // Epochs published since boot
+    uint32_t last_key;    // NMEA_KEY of the closing sentence, 0 if unset
+} gnss_epoch;
 
 LOG_MODULE_REGISTER(nmea, CONFIG_LOG_DEFAULT_LEVEL);
 
 void nmea_init(void)
 {
-    gnss_data = malloc(sizeof(GNSS_Data));
-    if (gnss_data != NULL) 
+    const char *last = CONFIG_LC29H_EPOCH_LAST;
+    memset(&gnss_epoch, 0, sizeof(gnss_epoch));
+    if (strlen(last) == 3) 
     {
-        memset(gnss_data, 0, sizeof(GNSS_Data));
+        gnss_epoch.last_key = NMEA_KEY(last[0], last[1], last[2]);
     }
+
+    memset(&gnss_data, 0, sizeof(gnss_data));
+    memset(gnss_published, 0, sizeof(gnss_published));
+    link_valid = 0;
+    link_invalid = 0;
+
+    k_spinlock_key_t key = k_spin_lock(&gnss_info_lock);
+
+    memset(&gnss_info, 0, sizeof(gnss_info));
+    k_spin_unlock(&gnss_info_lock, key);
 }
 
-// Helper function: Convert NMEA (DDMM.MMMM or DDDMM.MMMM) to decimal degrees
-static double nmea_to_decimal(double nmea_coord) 
+#ifdef CONFIG_LC29H_NMEA_BENCH
+void nmea_isolate(bool isolate)
 {
-    int degrees = (int)(nmea_coord / 100);
-    double minutes = nmea_coord - (degrees * 100);
-    return degrees + (minutes / 60.0);
+    gnss_isolated = isolate;
 }
+#endif
 
-TimeStruct nmea_parse_time(const char* time_str)
+// Publish the working record to readers
+static void gnss_publish(void)
 {
-    TimeStruct time = {0};
-    time.valid = false;
+    atomic_inc(&gnss_seq);  // Odd: readers use copy 1
+    gnss_published[0].data = gnss_data;
+    gnss_published[0].utc = UTC_time;
+    gnss_published[0].epoch = gnss_epoch.count;
+    gnss_published[0].sentences = gnss_epoch.sentences;
+
+    atomic_inc(&gnss_seq);  // Even: readers use copy 0
+    gnss_published[1] = gnss_published[0];
+}
 
-    if ((time_str == NULL) || (strlen(time_str) < 6))
+void gnss_get_snapshot(GNSS_Snapshot *snapshot)
+{
+    atomic_val_t seq;
+
+    do 
     {
-        return time;  // Invalid time format
-    }
+        seq = atomic_get(&gnss_seq);
+        memcpy(snapshot, &gnss_published[seq & 1], sizeof(*snapshot));
+    } while (atomic_get(&gnss_seq) != seq);
+}
 
-    // Example time format: "123456.78" (hhmmss.sss)
-    char buffer[3] = {0};
-    
-    // Extract hours (first 2 digits)
-    strncpy(buffer, time_str, 2);
-    time.hours = atoi(buffer);
-    
-    // Extract minutes (next 2 digits)
-    strncpy(buffer, time_str + 2, 2);
-    time.minutes = atoi(buffer);
-    
-    // Extract seconds (next 2 digits)
-    strncpy(buffer, time_str + 4, 2);
-    time.seconds = atoi(buffer);
-    
-    // Find decimal point for hundredths
-    const char* decimal_ptr = strchr(time_str, '.');
-    if ((decimal_ptr != NULL) && (strlen(decimal_ptr) > 1))
+// Helper function: Copy a sentence of len bytes and NUL terminate it
+static void nmea_copy(char *dest, size_t size, const char *src, size_t len)
+{
+    if (len > size - 1) 
     {
-        // Take up to 2 digits after decimal
-        strncpy(buffer, decimal_ptr + 1, 2);
-        time.millis = atoi(buffer);
+        len = size - 1;
     }
-    
-    // Validate ranges
-    if (time.hours < 24 && time.minutes < 60 && time.seconds < 60) 
+    memcpy(dest, src, len);
+    dest[len] = '\0';
+}
+
+// Helper macro: Unsigned field into an integer of any width
+#define NMEA_PARSE_UINT(token, len, dest) \
+    do { \
+        uint32_t _value; \
+        if (nmea_scan_uint(token, len, &_value)) (dest) = _value; \
+    } while (0)
+
+void gnss_get_info(GNSS_Info *info)
+{
+    k_spinlock_key_t key = k_spin_lock(&gnss_info_lock);
+
+    *info = gnss_info;
+    k_spin_unlock(&gnss_info_lock, key);
+}
+
+TimeStruct nmea_parse_time(const char* time_str, size_t len)
+{
+    TimeStruct time = {0};
+    uint32_t ms;
+
+    // Example time format: "123456.789" (hhmmss.sss)
+    time.valid = nmea_scan_time(time_str, len, &ms);
+    if (time.valid) 
     {
-        time.valid = true;
+        time.millis  = ms % 1000;
+        ms /= 1000;
+        time.seconds = ms % 60;
+        ms /= 60;
+        time.minutes = ms % 60;
+        time.hours   = ms / 60;
     }
-
-    // Combine into uint32_t timestamp (hhmmsshh format)
     return time;
 }
 
-void nmea_parse_gpgga(const char *nmea)
+#if defined(CONFIG_LC29H_NMEA_RMC) || defined(CONFIG_LC29H_NMEA_GGA) || defined(CONFIG_LC29H_NMEA_GLL)
+// Helper function: latitude, N/S, longitude, E/W from field on into the
+// working record. Unless all four are valid the position is cleared and
+// the fix marked invalid, so a bad field never leaves the last fix behind.
+static void nmea_parse_position(const NMEA_Fields *fields, int field)
 {
-    char *token; 
-    char copy[NMEA_MAX_LEN];
-    SAFE_STRNCPY(copy, nmea, sizeof(copy));
+    int32_t latitude, longitude;
 
-    token = strtok(copy, ",");
-    int field = 0;
-    
-    while (token != NULL) 
+    if ((field + 3 < fields->count) && (fields->len[field + 1] == 1) && (fields->len[field + 3] == 1) &&
+        nmea_scan_coord(NMEA_FIELD(fields, field), fields->len[field], &latitude) &&
+        nmea_scan_coord(NMEA_FIELD(fields, field + 2), fields->len[field + 2], &longitude) &&
+        ((uint32_t)latitude <= 900000000u) && ((uint32_t)longitude <= 1800000000u)) 
     {
-        switch (field) 
+        char ns = *NMEA_FIELD(fields, field + 1);
+        char ew = *NMEA_FIELD(fields, field + 3);
+
+        if (((ns == 'N') || (ns == 'S')) && ((ew == 'E') || (ew == 'W'))) 
         {
-            case 1:  // Timestamp (HHMMSS.SSS)
-                UTC_time = nmea_parse_time(token);
-                break;
-            case 2:  // Latitude (DDMM.MMMM)
-                gnss_data->latitude = nmea_to_decimal(atof(token));
-                break;
-            case 3:  // Latitude direction (N/S)
-                if (*token == 'S') gnss_data->latitude *= -1;
-                break;
-            case 4:  // Longitude (DDDMM.MMMM)
-                gnss_data->longitude = nmea_to_decimal(atof(token));
-                break;
-            case 5:  // Longitude direction (E/W)
-                if (*token == 'W') gnss_data->longitude *= -1;
-                break;
-            case 7:  // Satellites in use
-                gnss_data->satellites = atoi(token);
-                break;
-            case 9:  // Altitude (meters)
-                gnss_data->altitude = atof(token);
-                break;
+            gnss_data.latitude = (ns == 'S') ? -latitude : latitude;
+            gnss_data.longitude = (ew == 'W') ? -longitude : longitude;
+            return;
         }
-        token = strtok(NULL, ",");
-        field++;
     }
+
+    gnss_data.latitude = 0;
+    gnss_data.longitude = 0;
+    gnss_data.fix_quality = 0;
 }
+#endif
 
-void nmea_parse_gprmc(const char *nmea)
+#ifdef CONFIG_LC29H_NMEA_RMC
+// Helper function: DDMMYY date into the working record
+static void nmea_parse_date(const char *token, uint8_t len)
 {
-    char *token;
-    char copy[NMEA_MAX_LEN];
-    SAFE_STRNCPY(copy, nmea, sizeof(copy));
+    uint32_t date;
+
+    if ((len == 6) && nmea_scan_uint(token, len, &date)) 
+    {
+        gnss_data.day   = date / 10000;
+        gnss_data.month = (date / 100) % 100;
+        gnss_data.year  = 2000 + date % 100;
+    }
+}
 
-    token = strtok(copy, ",");
-    int field = 0;
-    
-    while (token != NULL) 
+// RMC: Recommended Minimum Navigation Information
+static void nmea_parse_rmc(const NMEA_Fields *fields)
+{
+    for (int field = 1; field < fields->count; field++) 
     {
+        const char *token = NMEA_FIELD(fields, field);
+
+        if (fields->len[field] == 0) 
+        {
+            continue;  // Empty field, keep the last value
+        }
+
         switch (field) 
         {
             case 1:  // Timestamp (HHMMSS.SSS)
-                UTC_time = nmea_parse_time(token);
+                UTC_time = nmea_parse_time(token, fields->len[field]);
                 break;
             case 2:  // Status (A=active, V=void)
-                //gnss_data->status = *token;
-                break;
-            case 3:  // Latitude (DDMM.MMMM)
-                gnss_data->latitude = nmea_to_decimal(atof(token));
-                break;
-            case 4:  // Latitude direction (N/S)
-                if (*token == 'S') gnss_data->latitude *= -1;
-                break;
-            case 5:  // Longitude (DDDMM.MMMM)
-                gnss_data->longitude = nmea_to_decimal(atof(token));
-                break;
-            case 6:  // Longitude direction (E/W)
-                if (*token == 'W') gnss_data->longitude *= -1;
+                //gnss_data.status = *token;
                 break;
+            // 3..6: Latitude (DDMM.MMMM), N/S, longitude (DDDMM.MMMM), E/W
             case 7:  // Speed (knots)
                 // Can be parsed if needed
                 break;
+            case 9:  // Date (DDMMYY)
+                nmea_parse_date(token, fields->len[field]);
+                break;
         }
-        token = strtok(NULL, ",");
-        field++;
     }
+    nmea_parse_position(fields, 3);
 }
 
-void nmea_parse_gngga(const char *nmea)
+#endif
+
+#ifdef CONFIG_LC29H_NMEA_GGA
+// GGA: Fix data (GP and GN talkers share the layout)
+static void nmea_parse_gga(const NMEA_Fields *fields)
 {
-    char copy[NMEA_MAX_LEN];
-    SAFE_STRNCPY(copy, nmea, sizeof(copy));
+    for (int field = 1; field < fields->count; field++) 
+    {
+        const char *token = NMEA_FIELD(fields, field);
 
-    char *token = strtok(copy, ",");
-    int field = 0;
+        if (fields->len[field] == 0) 
+        {
+            continue;  // Empty field, keep the last value
+        }
 
-    while (token != NULL) 
-    {
         switch (field) 
         {
             case 1: // Time
-                UTC_time = nmea_parse_time(token);
-                break;
-            case 2: // Latitude
-                gnss_data->latitude = nmea_to_decimal(atof(token));
-                break;
-            case 3: // N/S Indicator
-                //gnss_data->ns_indicator = *token;
-                //if (*token == 'S') gnss_data->latitude *= -1;
-                break;
-            case 4: // Longitude
-                gnss_data->longitude = nmea_to_decimal(atof(token));
-                break;
-            case 5: // E/W Indicator
-                //gnss_data->ew_indicator = *token;
-                //if (*token == 'W') gnss_data->longitude *= -1;
+                UTC_time = nmea_parse_time(token, fields->len[field]);
                 break;
+            // 2..5: Latitude, N/S, longitude, E/W
             case 6: // Fix Quality
-                gnss_data->fix_quality = atoi(token);
+                NMEA_PARSE_UINT(token, fields->len[field], gnss_data.fix_quality);
                 break;
             case 7: // Number of Satellites
-                //gnss_data->num_satellites = atoi(token);
+                NMEA_PARSE_UINT(token, fields->len[field], gnss_data.satellites);
                 break;
             case 8: // HDOP
-                //gnss_data->hdop = atof(token);
+                //nmea_scan_float(token, fields->len[field], &gnss_data.hdop);
                 break;
             case 9: // Altitude
-                gnss_data->altitude = atof(token);
+                nmea_scan_float(token, fields->len[field], &gnss_data.altitude);
                 break;
             case 10: // Altitude Units
-                //gnss_data->altitude_units = *token;
+                //gnss_data.altitude_units = *token;
                 break;
             case 11: // Geoid Separation
-                //gnss_data->geoid_separation = atof(token);
+                //nmea_scan_float(token, fields->len[field], &gnss_data.geoid_separation);
                 break;
             case 12: // Geoid Units
-                //gnss_data->geoid_units = *token;
+                //gnss_data.geoid_units = *token;
                 break;
             case 13: // Age of Differential Correction
-                //SAFE_STRNCPY(gnss_data->age_of_diff_corr, token, sizeof(gnss_data->age_of_diff_corr));
+                //SAFE_STRNCPY(gnss_data.age_of_diff_corr, token, sizeof(gnss_data.age_of_diff_corr));
                 break;
             case 14: // Diff Ref Station ID
-                //SAFE_STRNCPY(gnss_data->diff_ref_station_id, token, sizeof(gnss_data->diff_ref_station_id));
+                //SAFE_STRNCPY(gnss_data.diff_ref_station_id, token, sizeof(gnss_data.diff_ref_station_id));
                 break;
         }
-        token = strtok(NULL, ",");
-        field++;
     }
+    nmea_parse_position(fields, 2);
 }
 
-#ifdef GSA
-void nmea_parse_gpgsa(const char *nmea) 
-{
-    char *token;
-    char copy[NMEA_MAX_LEN];
-    SAFE_STRNCPY(copy, nmea, sizeof(copy));
+#endif
 
-    token = strtok(copy, ",");
-    int field = 0;
-    
-    while (token != NULL) 
+#ifdef CONFIG_LC29H_NMEA_GSA
+static void nmea_parse_gsa(const NMEA_Fields *fields)
+{
+    for (int field = 1; field < fields->count; field++) 
     {
+        const char *token = NMEA_FIELD(fields, field);
+
+        if (fields->len[field] == 0) 
+        {
+            continue;  // Empty field, keep the last value
+        }
+
         switch (field) 
         {
             case 2:  // Fix Type (1=No fix, 2=2D, 3=3D)
-                gnss_data->fix_quality = atoi(token);
+                NMEA_PARSE_UINT(token, fields->len[field], gnss_data.fix_quality);
                 break;
             case 15: // PDOP
-                gnss_data->pdop = atof(token);
+                nmea_scan_float(token, fields->len[field], &gnss_data.pdop);
                 break;
             case 16: // HDOP
-                gnss_data->hdop = atof(token);
+                nmea_scan_float(token, fields->len[field], &gnss_data.hdop);
                 break;
             case 17: // VDOP
-                gnss_data->vdop = atof(token);
+                nmea_scan_float(token, fields->len[field], &gnss_data.vdop);
                 break;
         }
-        token = strtok(NULL, ",");
-        field++;
     }
 }
 #endif
 
-#ifdef GSV
-void nmea_parse_gpgsv(const char *nmea) 
+#ifdef CONFIG_LC29H_NMEA_GSV
+static void nmea_parse_gsv(const NMEA_Fields *fields) 
 {
-    char *token;
-    char copy[NMEA_MAX_LEN];
-    SAFE_STRNCPY(copy, nmea, sizeof(copy));
+    uint32_t total = 0;
+    uint32_t message = 0;
+    uint8_t signal = 0;
+    uint8_t last = fields->count;
+
+    if ((fields->count < 4) || !nmea_scan_uint(NMEA_FIELD(fields, 1), fields->len[1], &total) ||
+        !nmea_scan_uint(NMEA_FIELD(fields, 2), fields->len[2], &message) ||
+        (message == 0) || (message > total) || (total > UINT8_MAX)) 
+    {
+        return;
+    }
 
-    token = strtok(copy, ",");
-    int field = 0;
-    int sat_index = 0;
-    
-    while (token != NULL) 
+    // 4 fields per satellite, then the NMEA 4.11 signal ID (one hex digit) if sent
+    if ((fields->count - 4) % 4 == 1) 
     {
-        switch (field) 
+        const char *token = NMEA_FIELD(fields, --last);
+
+        if (fields->len[last] == 1) 
         {
-            case 3:  // Total Satellites in View
-                gnss_data->total_sats_in_view = atoi(token);
-                break;
-            case 4:  // Satellite PRN (first of up to 4 per message)
-            case 8:  // Second satellite
-            case 12: // Third satellite
-            case 16: // Fourth satellite
-                if (sat_index < 24) 
-                {
-                    gnss_data->sat_info[sat_index].prn = atoi(token);
-                    sat_index++;
-                }
-                break;
-            case 5:  // Elevation (first satellite)
-            case 9:  // Second satellite
-            case 13: // Third satellite
-            case 17: // Fourth satellite
-                if (sat_index > 0) 
-                {
-                    gnss_data->sat_info[sat_index-1].elevation = atoi(token);
-                }
-                break;
-            case 6:  // Azimuth (first satellite)
-            case 10: // Second satellite
-            case 14: // Third satellite
-            case 18: // Fourth satellite
-                if (sat_index > 0) 
-                {
-                    gnss_data->sat_info[sat_index-1].azimuth = atoi(token);
-                }
-                break;
-            case 7:  // SNR (first satellite)
-            case 11: // Second satellite
-            case 15: // Third satellite
-            case 19: // Fourth satellite
-                if (sat_index > 0) 
-                {
-                    gnss_data->sat_info[sat_index-1].snr = atoi(token);
-                }
-                break;
+            signal = (*token >= 'A') ? (*token - 'A' + 10) : (*token - '0');
+        }
+    }
+
+    gnss_sats_gsv_begin(fields->talker, signal, message);
+    for (int field = 4; field + 3 < last; field += 4) 
+    {
+        uint32_t prn, elevation = 0, azimuth = 0, snr = 0;
+
+        if (!nmea_scan_uint(NMEA_FIELD(fields, field), fields->len[field], &prn) || (prn > UINT8_MAX)) 
+        {
+            continue;
         }
-        token = strtok(NULL, ",");
-        field++;
+        // Empty until the receiver has an almanac or tracks the signal
+        nmea_scan_uint(NMEA_FIELD(fields, field + 1), fields->len[field + 1], &elevation);
+        nmea_scan_uint(NMEA_FIELD(fields, field + 2), fields->len[field + 2], &azimuth);
+        nmea_scan_uint(NMEA_FIELD(fields, field + 3), fields->len[field + 3], &snr);
+        gnss_sats_gsv_sat(prn, MIN(elevation, 90), MIN(azimuth, 359), MIN(snr, 99));
     }
+    gnss_sats_gsv_end(message, total);
 }
 #endif
 
-#ifdef VTG
-void nmea_parse_gpvtg(const char *nmea) 
+#ifdef CONFIG_LC29H_NMEA_VTG
+static void nmea_parse_vtg(const NMEA_Fields *fields)
 {
-    char *token;
-    char copy[NMEA_MAX_LEN];
-    SAFE_STRNCPY(copy, nmea, sizeof(copy));
-
-    token = strtok(copy, ",");
-    int field = 0;
-    
-    while (token != NULL) 
+    for (int field = 1; field < fields->count; field++) 
     {
+        const char *token = NMEA_FIELD(fields, field);
+
+        if (fields->len[field] == 0) 
+        {
+            continue;  // Empty field, keep the last value
+        }
+
         switch (field) 
         {
             case 1:  // True Course (degrees)
-                gnss_data->course = atof(token);
+                nmea_scan_float(token, fields->len[field], &gnss_data.course);
                 break;
             case 7:  // Speed (km/h)
-                gnss_data->speed = atof(token);
+                nmea_scan_float(token, fields->len[field], &gnss_data.speed);
                 break;
         }
-        token = strtok(NULL, ",");
-        field++;
     }
 }
 #endif
 
-#ifdef GLL
-void nmea_parse_gpgll(const char *nmea) 
+#ifdef CONFIG_LC29H_NMEA_GLL
+static void nmea_parse_gll(const NMEA_Fields *fields)
 {
-    char *token;
-    char copy[NMEA_MAX_LEN];
-    SAFE_STRNCPY(copy, nmea, sizeof(copy));
+    for (int field = 1; field < fields->count; field++) 
+    {
+        const char *token = NMEA_FIELD(fields, field);
 
-    token = strtok(copy, ",");
-    int field = 0;
-    
-    while (token != NULL) 
+        if (fields->len[field] == 0) 
+        {
+            continue;  // Empty field, keep the last value
+        }
+
+        switch (field) 
+        {
+            // 1..4: Latitude (DDMM.MMMM), N/S, longitude (DDDMM.MMMM), E/W
+            case 5:  // UTC Time (HHMMSS.SSS)
+                UTC_time = nmea_parse_time(token, fields->len[field]);
+                break;
+            case 6:  // Status (A=Valid, V=Invalid)
+                gnss_data.fix_quality = (*token == 'A') ? 1 : 0;
+                break;
+        }
+    }
+    nmea_parse_position(fields, 1);
+}
+#endif
+#ifdef CONFIG_LC29H_NMEA_GST
+// GST: Pseudorange error statistics
+static void nmea_parse_gst(const NMEA_Fields *fields)
+{
+    for (int field = 6; field < fields->count; field++) 
     {
+        const char *token = NMEA_FIELD(fields, field);
+
+        if (fields->len[field] == 0) 
+        {
+            continue;  // Empty field, keep the last value
+        }
+
         switch (field) 
         {
-            case 1:  // Latitude (DDMM.MMMM)
-                gnss_data->latitude = atof(token) / 100.0;
+            case 6:  // Latitude error (1 sigma, m)
+                nmea_scan_float(token, fields->len[field], &gnss_data.std_latitude);
                 break;
-            case 2:  // N/S
-                if (*token == 'S') gnss_data->latitude *= -1;
+            case 7:  // Longitude error (1 sigma, m)
+                nmea_scan_float(token, fields->len[field], &gnss_data.std_longitude);
                 break;
-            case 3:  // Longitude (DDDMM.MMMM)
-                gnss_data->longitude = atof(token) / 100.0;
+            case 8:  // Altitude error (1 sigma, m)
+                nmea_scan_float(token, fields->len[field], &gnss_data.std_altitude);
                 break;
-            case 4:  // E/W
-                if (*token == 'W') gnss_data->longitude *= -1;
+        }
+    }
+}
+#endif
+
+#ifdef CONFIG_LC29H_NMEA_ZDA
+// ZDA: UTC time and date
+static void nmea_parse_zda(const NMEA_Fields *fields)
+{
+    for (int field = 1; field < fields->count; field++) 
+    {
+        const char *token = NMEA_FIELD(fields, field);
+
+        if (fields->len[field] == 0) 
+        {
+            continue;  // Empty field, keep the last value
+        }
+
+        switch (field) 
+        {
+            case 1:  // UTC Time (HHMMSS.SSS)
+                UTC_time = nmea_parse_time(token, fields->len[field]);
                 break;
-            case 5:  // UTC Time (HHMMSS.SSS)
-                SAFE_STRNCPY(gnss_data->timestamp, token, sizeof(gnss_data->timestamp));
+            case 2:  // Day
+                NMEA_PARSE_UINT(token, fields->len[field], gnss_data.day);
                 break;
-            case 6:  // Status (A=Valid, V=Invalid)
-                gnss_data->fix_quality = (*token == 'A') ? 1 : 0;
+            case 3:  // Month
+                NMEA_PARSE_UINT(token, fields->len[field], gnss_data.month);
+                break;
+            case 4:  // Year (YYYY)
+                NMEA_PARSE_UINT(token, fields->len[field], gnss_data.year);
                 break;
         }
-        token = strtok(NULL, ",");
-        field++;
     }
 }
 #endif
-void parse_pqverno(const char *sentence) 
-{
-    char copy[NMEA_MAX_LEN];
-    SAFE_STRNCPY(copy, sentence, sizeof(copy));
-    copy[sizeof(copy)-1] = '\0';
 
-    char *token = strtok(copy, ",");
-    int index = 0;
-    while (token != NULL) 
+#ifdef CONFIG_LC29H_NMEA_GRS
+// GRS: Range residuals, one per satellite used in the solution
+static void nmea_parse_grs(const NMEA_Fields *fields)
+{
+    // Fields 3..14 hold the residuals (m), in the order of the GSA PRNs
+    for (int field = 3; (field < fields->count) && (field < 15); field++) 
     {
-        if (index == 2) 
-        {  // SW Version is usually the 3rd token
-            strncpy(gnss_data->firmware_version, token, sizeof(gnss_data->firmware_version));
-            gnss_data->firmware_version[sizeof(gnss_data->firmware_version)-1] = '\0';
-            break;
-        }
-        token = strtok(NULL, ",");
-        index++;
+        int32_t residual = 0;  // Empty: no satellite in this slot
+
+        nmea_scan_fixed(NMEA_FIELD(fields, field), fields->len[field], 2, &residual);
+        gnss_data.range_residuals[field - 3] = CLAMP(residual, INT16_MIN, INT16_MAX);
     }
 }
+#endif
 
-uint8_t nmea_valid_checksum(const char *sentence) 
+static void parse_pqverno(const NMEA_Fields *fields) 
 {
-    uint8_t checksum= (uint8_t)strtol(strchr(sentence, '*')+1, NULL, 16);
+    // SW Version is usually the 3rd token
+    if (fields->count > 2) 
+    {
+        k_spinlock_key_t key = k_spin_lock(&gnss_info_lock);
 
-    char p;
+        nmea_copy(gnss_info.firmware_version, sizeof(gnss_info.firmware_version),
+                  NMEA_FIELD(fields, 2), fields->len[2]);
+        k_spin_unlock(&gnss_info_lock, key);
+    }
+}
+
+// Split the sentence into fields and verify its checksum in one pass
+uint8_t nmea_tokenize(const char *sentence, size_t len, NMEA_Fields *fields) 
+{
     uint8_t sum = 0;
-    ++sentence;
-    while ((p = *sentence++) != '*') 
+    size_t i;
+
+    fields->sentence = sentence;
+    fields->count = 1;
+    fields->talker = NMEA_TALKER_UNKNOWN;
+    fields->start[0] = 1;
+
+    if ((len < 6) || (len > UINT8_MAX) || (sentence[0] != '$')) 
     {
-        sum ^= p;
+        return NMEA_MESSAGE_ERR;
     }
 
-    if (sum != checksum) 
+    for (i = 1; (i < len) && (sentence[i] != '*'); i++) 
+    {
+        sum ^= sentence[i];
+
+        if (sentence[i] == ',') 
+        {
+            uint8_t n = fields->count - 1;
+            fields->len[n] = i - fields->start[n];
+            if (fields->count == NMEA_MAX_FIELDS) 
+            {
+                return NMEA_MESSAGE_ERR;
+            }
+            fields->start[fields->count++] = i + 1;
+        }
+    }
+    fields->len[fields->count - 1] = i - fields->start[fields->count - 1];
+
+    // Need "*hh" after the data, then nothing but the line end
+    uint32_t expected;
+    if ((i + 2 >= len) || !nmea_scan_hex(&sentence[i + 1], 2, &expected) || (sum != expected) ||
+        ((i + 3 < len) && (sentence[i + 3] != '\r') && (sentence[i + 3] != '\n'))) 
     {
         return NMEA_CHECKSUM_ERROR;
     }
@@ -415,100 +549,286 @@ uint8_t nmea_valid_checksum(const char *sentence)
     return _EMPTY;
 }
 
-NMEA_MessageType nmea_get_message_type(const char *sentence) 
+#define NMEA_DISPATCH_BITS 6
+#define NMEA_DISPATCH_SLOT(key) ((uint32_t)((key) * 2654435761u) >> (32 - NMEA_DISPATCH_BITS))
+#define NMEA_HANDLER(key, name, type, parse, field) \
+    [NMEA_DISPATCH_SLOT(key)] = { key, name, type, parse, field }
+
+/* Handlers keyed on the sentence code; talkers share a handler. Each one
+ * sits at the hash of its key, so the compiler lays the table out and a
+ * lookup is a single probe. New sentences register by adding an entry
+ * here and its key to the check below. */
+static const NMEA_Handler nmea_dispatch[1 << NMEA_DISPATCH_BITS] = 
+{
+#ifdef CONFIG_LC29H_NMEA_GGA
+    NMEA_HANDLER(NMEA_KEY('G', 'G', 'A'),       NULL,        NMEA_GGA,        nmea_parse_gga, 1),
+#endif
+#ifdef CONFIG_LC29H_NMEA_RMC
+    NMEA_HANDLER(NMEA_KEY('R', 'M', 'C'),       NULL,        NMEA_RMC,        nmea_parse_rmc, 1),
+#endif
+#ifdef CONFIG_LC29H_NMEA_GSA
+    NMEA_HANDLER(NMEA_KEY('G', 'S', 'A'),       NULL,        NMEA_GSA,        nmea_parse_gsa, 0),
+#endif
+#ifdef CONFIG_LC29H_NMEA_GSV
+    NMEA_HANDLER(NMEA_KEY('G', 'S', 'V'),       NULL,        NMEA_GSV,        nmea_parse_gsv, 0),
+#endif
+#ifdef CONFIG_LC29H_NMEA_VTG
+    NMEA_HANDLER(NMEA_KEY('V', 'T', 'G'),       NULL,        NMEA_VTG,        nmea_parse_vtg, 0),
+#endif
+#ifdef CONFIG_LC29H_NMEA_GLL
+    NMEA_HANDLER(NMEA_KEY('G', 'L', 'L'),       NULL,        NMEA_GLL,        nmea_parse_gll, 5),
+#endif
+#ifdef CONFIG_LC29H_NMEA_GST
+    NMEA_HANDLER(NMEA_KEY('G', 'S', 'T'),       NULL,        NMEA_GST,        nmea_parse_gst, 1),
+#endif
+#ifdef CONFIG_LC29H_NMEA_ZDA
+    NMEA_HANDLER(NMEA_KEY('Z', 'D', 'A'),       NULL,        NMEA_ZDA,        nmea_parse_zda, 1),
+#endif
+#ifdef CONFIG_LC29H_NMEA_GRS
+    NMEA_HANDLER(NMEA_KEY('G', 'R', 'S'),       NULL,        NMEA_GRS,        nmea_parse_grs, 1),
+#endif
+    NMEA_HANDLER(NMEA_PKEY_N(9, 'R', 'N', 'O'), "PQTMVERNO", NMEA_PQTMVERNO,  parse_pqverno,  0),
+};
+
+// Every key gets a slot of its own, whichever sentences are enabled
+#define NMEA_DISPATCH_BIT(key) BIT64(NMEA_DISPATCH_SLOT(key))
+BUILD_ASSERT(__builtin_popcountll(NMEA_DISPATCH_BIT(NMEA_KEY('G', 'G', 'A')) |
+                                  NMEA_DISPATCH_BIT(NMEA_KEY('R', 'M', 'C')) |
+                                  NMEA_DISPATCH_BIT(NMEA_KEY('G', 'S', 'A')) |
+                                  NMEA_DISPATCH_BIT(NMEA_KEY('G', 'S', 'V')) |
+                                  NMEA_DISPATCH_BIT(NMEA_KEY('V', 'T', 'G')) |
+                                  NMEA_DISPATCH_BIT(NMEA_KEY('G', 'L', 'L')) |
+                                  NMEA_DISPATCH_BIT(NMEA_KEY('G', 'S', 'T')) |
+                                  NMEA_DISPATCH_BIT(NMEA_KEY('Z', 'D', 'A')) |
+                                  NMEA_DISPATCH_BIT(NMEA_KEY('G', 'R', 'S')) |
+                                  NMEA_DISPATCH_BIT(NMEA_PKEY_N(9, 'R', 'N', 'O'))) == 10,
+             "NMEA handler keys share a dispatch slot; change NMEA_DISPATCH_BITS");
+
+static NMEA_Talker nmea_talker(char a, char b)
 {
-    char *token;
-    char copy[NMEA_MAX_LEN];
-    SAFE_STRNCPY(copy, sentence, sizeof(copy));
-    // Validate checksum first
-    uint8_t checksum_status = nmea_valid_checksum(sentence);
-    if (checksum_status == NMEA_CHECKSUM_ERROR) 
+    if (a != 'G') 
     {
-        return NMEA_CHECKSUM_ERROR;
+        return (a == 'B' && b == 'D') ? NMEA_TALKER_GB : NMEA_TALKER_UNKNOWN;
     }
-    
-    token = strtok(copy, ",");
-
-    // Detect token type
-    if (strstr(token, NMEA_GPGGA_WORD) != NULL) return NMEA_GPGGA;
-    if (strstr(token, NMEA_GPRMC_WORD) != NULL) return NMEA_GPRMC;
-    if (strstr(token, NMEA_GNGGA_WORD) != NULL) return NMEA_GNGGA;
-    //if (strstr(token, NMEA_GPVTG_WORD) != NULL) return NMEA_GPVTG;
-    //if (strstr(token, NMEA_GPGSA_WORD) != NULL) return NMEA_GPGSA;
-    //if (strstr(token, NMEA_GPGSV_WORD) != NULL) return NMEA_GPGSV;
-    //if (strstr(token, NMEA_GPGLL_WORD) != NULL) return NMEA_GPGLL;
-    //if (strstr(token, NMEA_GPZDA_WORD) != NULL) return NMEA_GPZDA;
-    //if (strstr(token, NMEA_GPGST_WORD) != NULL) return NMEA_GPGST;
-    //if (strstr(token, NMEA_GPGNS_WORD) != NULL) return NMEA_GPGNS;
-    if (strstr(token, NMEA_PQVERNO_WORD) != NULL) return NMEA_PQVERNO;
 
-    return NMEA_UNKNOWN;
+    switch (b) 
+    {
+        case 'P': return NMEA_TALKER_GP;
+        case 'L': return NMEA_TALKER_GL;
+        case 'A': return NMEA_TALKER_GA;
+        case 'B': return NMEA_TALKER_GB;
+        case 'Q': return NMEA_TALKER_GQ;
+        case 'I': return NMEA_TALKER_GI;
+        case 'N': return NMEA_TALKER_GN;
+        default:  return NMEA_TALKER_UNKNOWN;
+    }
 }
 
-static void handle_unknown(const char *sentence) 
+// Resolve the address field to its handler and set fields->talker
+static const NMEA_Handler *nmea_lookup(NMEA_Fields *fields)
 {
-    char buffer[16]; // Local buffer to store the sentence type
- 
-    // Extract the first part of the sentence (e.g., "$GPGGA")
-    const char *delimiter = strchr(sentence, ','); // Find the first comma
-    if (delimiter != NULL)
+    const char *addr = NMEA_FIELD(fields, 0);
+    uint8_t len = fields->len[0];
+    const NMEA_Handler *handler;
+    uint32_t key;
+
+    if (len < 5) 
     {
-        size_t length = delimiter - sentence; // Calculate the length of the sentence type
-        if (length >= sizeof(buffer))
-        {
-            length = sizeof(buffer) - 1; // Ensure we don't overflow the buffer
-        }
-        strncpy(buffer, sentence, length); // Copy the sentence type to buffer
-        buffer[length] = '\0'; // Null-terminate the string
-    } 
+        return NULL;
+    }
+
+    if (addr[0] == 'P') 
+    {
+        fields->talker = NMEA_TALKER_PROPRIETARY;
+        key = NMEA_PKEY_N(len, addr[len - 3], addr[len - 2], addr[len - 1]);
+    }
+    else if (len == 5) 
+    {
+        fields->talker = nmea_talker(addr[0], addr[1]);
+        key = NMEA_KEY(addr[2], addr[3], addr[4]);
+    }
     else 
     {
-        strncpy(buffer, sentence, sizeof(buffer) - 1); // Handle case with no comma
-        buffer[sizeof(buffer) - 1] = '\0'; // Null-terminate the string
+        return NULL;
+    }
+
+    handler = &nmea_dispatch[NMEA_DISPATCH_SLOT(key)];
+    if ((handler->parse != NULL) && (handler->key == key) && 
+        ((handler->name == NULL) || (memcmp(handler->name, addr, len) == 0))) 
+    {
+        return handler;
     }
+
+    return NULL;
+}
+
+NMEA_MessageType nmea_get_message_type(NMEA_Fields *fields) 
+{
+    const NMEA_Handler *handler = nmea_lookup(fields);
+
+    return (handler != NULL) ? handler->type : NMEA_UNKNOWN;
+}
+
+static void handle_unknown(const NMEA_Fields *fields) 
+{
+    char buffer[16]; // Local buffer to store the sentence type
+ 
+    // The first field is the sentence type (e.g., "GPGGA")
+    nmea_copy(buffer, sizeof(buffer), NMEA_FIELD(fields, 0), fields->len[0]);
  
     LOG_DBG("UNKNOWN: %s\n", buffer); // Print the extracted sentence type
 }
 
+#ifdef CONFIG_LC29H_NOTIFY
+// Update classes present in the epoch being closed
+static uint32_t gnss_epoch_events(void)
+{
+    uint32_t events = 0;
+
+    if (gnss_epoch.sentences & (BIT(NMEA_GGA) | BIT(NMEA_RMC) | BIT(NMEA_GLL))) 
+    {
+        events |= GNSS_EVT_POSITION;
+    }
+    if (UTC_time.valid) 
+    {
+        events |= GNSS_EVT_TIME;
+    }
+    if (gnss_epoch.sentences & (BIT(NMEA_GSA) | BIT(NMEA_GSV))) 
+    {
+        events |= GNSS_EVT_SATELLITES;
+    }
+    return events;
+}
+#endif
+
+// Close the epoch being assembled and hand it to readers
+static void gnss_epoch_emit(void)
+{
+    if (gnss_epoch.sentences == 0) 
+    {
+        return;
+    }
+    gnss_epoch.count++;
+#ifdef CONFIG_LC29H_NMEA_GSV
+    gnss_sats_epoch();
+    gnss_data.total_sats_in_view = gnss_sats_count();
+#endif
+    if (!gnss_isolated) 
+    {
+        gnss_publish();
+#ifdef CONFIG_LC29H_HISTORY
+        gnss_history_add(&gnss_data, &UTC_time);
+#endif
+#ifdef CONFIG_LC29H_TRACK
+        gnss_track_add(&gnss_data, &UTC_time);
+#endif
+#ifdef CONFIG_LC29H_NOTIFY
+        gnss_notify(gnss_epoch_events());
+#endif
+    }
+    gnss_epoch.sentences = 0;
+    gnss_epoch.timed = false;
+}
+
+/* A timed sentence starts a new epoch when its time differs from the
+ * epoch's, or when the epoch already holds one of its type (receivers
+ * without a fix may leave the time empty). Untimed sentences (GSA, GSV,
+ * VTG) always belong to the epoch in progress. */
+static void gnss_epoch_check(const NMEA_Handler *handler, const NMEA_Fields *fields)
+{
+    uint8_t field = handler->time_field;
+    uint32_t time_ms;
+    bool timed;
+
+    if ((field == 0) || (field >= fields->count)) 
+    {
+        return;
+    }
+    timed = nmea_scan_time(NMEA_FIELD(fields, field), fields->len[field], &time_ms);
+
+    if ((gnss_epoch.sentences & BIT(handler->type)) ||
+        (timed && gnss_epoch.timed && (time_ms != gnss_epoch.time_ms))) 
+    {
+        gnss_epoch_emit();
+    }
+
+    if (timed) 
+    {
+        gnss_epoch.time_ms = time_ms;
+        gnss_epoch.timed = true;
+    }
+}
+
 /* NMEA Processing */
-void nmea_processing(const char *sentence)
+void nmea_link_counts(uint32_t *valid, uint32_t *invalid)
 {
-    uint8_t msgtype;
-     
-    // Dispatch to appropriate handler
-    msgtype = nmea_get_message_type(sentence);
-    if (msgtype == NMEA_CHECKSUM_ERROR) 
+    *valid = link_valid;
+    *invalid = link_invalid;
+}
+
+void nmea_reject_sentence(uint8_t error)
+{
+    link_invalid++;
+    if (error == NMEA_CHECKSUM_ERROR) 
+    {
+        GNSS_STATS_INC(checksum_errors);
+    }
+    else 
+    {
+        GNSS_STATS_INC(malformed);
+    }
+}
+
+void nmea_process_sentence(const char *sentence, size_t len)
+{
+    NMEA_Fields fields;
+    uint8_t ret = nmea_tokenize(sentence, len, &fields);
+
+    if (ret != _EMPTY) 
     {
+        nmea_reject_sentence(ret);
         return;
     }
-    
-    switch (msgtype) 
-    {
-        case NMEA_GPGGA:
-            nmea_parse_gpgga(sentence);
-        break;
-        case NMEA_GPRMC:
-            nmea_parse_gprmc(sentence);
-        break;
-        case NMEA_GNGGA:
-            nmea_parse_gngga(sentence);
-        break;
-        case NMEA_GPGLL:
-        case NMEA_GPGSV:
-        case NMEA_GPGSA:
-        case NMEA_GPGST:
-        case NMEA_GPZDA:
-        case NMEA_GPGNS:
-            handle_unknown(sentence);
-        break;
-        case NMEA_PQVERNO:
-            parse_pqverno(sentence);
-        break;
-        default:
-            // Unhandled message type
-            handle_unknown(sentence);
-        break;
+    nmea_process_fields(&fields);
+}
+
+void nmea_process_fields(NMEA_Fields *fields)
+{
+    link_valid++;
+
+    // Dispatch to appropriate handler
+    const NMEA_Handler *handler = nmea_lookup(fields);
+    if (handler != NULL) 
+    {
+        GNSS_STATS_INC(sentences[handler->type]);
+        gnss_epoch_check(handler, fields);
+        handler->parse(fields);
+        gnss_epoch.sentences |= BIT(handler->type);
+
+        if (handler->key == gnss_epoch.last_key) 
+        {
+            gnss_epoch_emit();
+        }
+    }
+    else 
+    {
+        // Unhandled message type
+        GNSS_STATS_INC(sentences[NMEA_UNKNOWN]);
+        handle_unknown(fields);
+    }
+
+#ifdef CONFIG_LC29H_CMD
+    // Command ACKs and responses
+    if (fields->talker == NMEA_TALKER_PROPRIETARY) 
+    {
+        nmea_cmd_response(fields);
     }
+#endif
+}
+
+void nmea_processing(const char *sentence)
+{
+    nmea_process_sentence(sentence, strlen(sentence));
 }
 
 void nmea_enable_pps_sync(void)
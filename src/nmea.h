@@ -11,52 +11,41 @@
 #define _COMPLETED 0x03
 #define NMEA_MESSAGE_ERR 0xC0
 #define NMEA_MAX_LEN 82
+#define NMEA_MAX_FIELDS 24
 
-/* LC29H-Specific Commands */
-#define LC29H_SAVE_CFG         "$PQTMSAVEPAR*5A\r\n" 
-#define LC29H_VERNO_CMD        "$PQTMVERNO*58\r\n"
-#define LC29H_SET_BAUD         "$PAIR864,0,0,115200*\r\n"
-#define LC29H_UPDATE_RATE_CMD  "$PQTXT,W,UPDATE,100*2F\r\n"
-#define LC29H_DEFAULT8CFG      "$PQTMRESTOREPAR*13\r\n" 
-#define LC29H_ENABLE_GGA       "$PAIR062,0,1*3B\r\n"
-#define LC29H_ENABLE_GLL       "$PAIR062,1,1*3A\r\n"
-#define LC29H_ENABLE_GSA       "$PAIR062,2,1*3F\r\n"
-#define LC29H_ENABLE_GSV       "$PAIR062,3,1*3E\r\n"
-#define LC29H_ENABLE_RMC       "$PAIR062,4,1*3D\r\n"
-#define LC29H_ENABLE_VTG       "$PAIR062,5,1*38\r\n"
-#define LC29H_DISABLE_GGA      "$PAIR062,0,0*3A\r\n"
-#define LC29H_DISABLE_GLL      "$PAIR062,1,0*3B\r\n"  
-#define LC29H_DISABLE_GSA      "$PAIR062,2,0*3C\r\n"  
-#define LC29H_DISABLE_GSV      "$PAIR062,3,0*3D\r\n"  
-#define LC29H_DISABLE_RMC      "$PAIR062,4,0*3E\r\n"  
-#define LC29H_DISABLE_VTG      "$PAIR062,5,0*3B\r\n"
+/* LC29H-Specific Commands. Bodies only: send_nmea_message() adds the
+ * checksum and line terminator. */
+#define LC29H_SAVE_CFG         "$PQTMSAVEPAR" 
+#define LC29H_VERNO_CMD        "$PQTMVERNO"
+#define LC29H_SET_BAUD         "$PAIR864,0,0,%u"   // printf format
+#define LC29H_UPDATE_RATE_CMD  "$PQTXT,W,UPDATE,100"
+#define LC29H_DEFAULT8CFG      "$PQTMRESTOREPAR" 
+#define LC29H_ENABLE_GGA       "$PAIR062,0,1"
+#define LC29H_ENABLE_GLL       "$PAIR062,1,1"
+#define LC29H_ENABLE_GSA       "$PAIR062,2,1"
+#define LC29H_ENABLE_GSV       "$PAIR062,3,1"
+#define LC29H_ENABLE_RMC       "$PAIR062,4,1"
+#define LC29H_ENABLE_VTG       "$PAIR062,5,1"
+#define LC29H_DISABLE_GGA      "$PAIR062,0,0"
+#define LC29H_DISABLE_GLL      "$PAIR062,1,0"  
+#define LC29H_DISABLE_GSA      "$PAIR062,2,0"  
+#define LC29H_DISABLE_GSV      "$PAIR062,3,0"  
+#define LC29H_DISABLE_RMC      "$PAIR062,4,0"  
+#define LC29H_DISABLE_VTG      "$PAIR062,5,0"
 
 /* NMEA Sentence Enable Commands */
-#define NMEA_SET_STDBY_CMD     "$PMTK161,0*28\r\n"     // Enter standby mode
-#define NMEA_HOT_RST_CMD       "$PMTK101*32\r\n"       // Hot reset (fastest, keeps ephemeris)
-#define NMEA_WARM_RST_CMD      "$PMTK102*31\r\n"       // Warm reset (keeps almanac)
-#define NMEA_COLD_RST_CMD      "$PMTK103*30\r\n"       // Cold reset (clears ephemeris, keeps almanac)
-#define NMEA_FCOLD_RST_CMD     "$PMTK104*37\r\n"       // Factory cold reset (full reset)
-#define NMEA_CLR_FLASH_CMD     "$PMTK120*31\r\n"       // Clear flash data
-#define NMEA_CLEAR_ORBIT_CMD   "$PMTK127*36\r\n"       // Clear assisted ephemeris (AGPS)
-#define NMEA_FIXINT_CMD        "$PMTK220,1000*1F\r\n"  // Fix interval (1000 ms = 1 Hz)
-#define NMEA_FIXINT_5HZ_CMD    "$PMTK220,200*2C\r\n"   // Fix interval (200 ms = 5 Hz)
-#define NMEA_FIXINT_10HZ_CMD   "$PMTK220,100*2F\r\n"   // Fix interval (100 ms = 10 Hz)
-#define NMEA_ENABLE_PPS_SYNC   "$PMTK255,1*2D\r\n"     // Enable PPS Sync
-#define NMEA_DISABLE_PPS_SYNC  "$PMTK255,0*2C\r\n"     // Disable PPS Sync
-
-// NMEA Sentence Identifiers
-#define NMEA_GPGGA_WORD "$GPGGA"
-#define NMEA_GPRMC_WORD "$GPRMC"
-#define NMEA_GPVTG_WORD "$GPVTG"
-#define NMEA_GPGSA_WORD "$GPGSA"
-#define NMEA_GPGSV_WORD "$GPGSV"
-#define NMEA_GPGLL_WORD "$GPGLL"
-#define NMEA_GPZDA_WORD "$GPZDA"
-#define NMEA_GPGST_WORD "$GPGST"
-#define NMEA_GPGNS_WORD "$GPGNS"
-#define NMEA_GNGGA_WORD "$GNGGA"
-#define NMEA_PQVERNO_WORD "$PQTMVERNO"
+#define NMEA_SET_STDBY_CMD     "$PMTK161,0"     // Enter standby mode
+#define NMEA_HOT_RST_CMD       "$PMTK101"       // Hot reset (fastest, keeps ephemeris)
+#define NMEA_WARM_RST_CMD      "$PMTK102"       // Warm reset (keeps almanac)
+#define NMEA_COLD_RST_CMD      "$PMTK103"       // Cold reset (clears ephemeris, keeps almanac)
+#define NMEA_FCOLD_RST_CMD     "$PMTK104"       // Factory cold reset (full reset)
+#define NMEA_CLR_FLASH_CMD     "$PMTK120"       // Clear flash data
+#define NMEA_CLEAR_ORBIT_CMD   "$PMTK127"       // Clear assisted ephemeris (AGPS)
+#define NMEA_FIXINT_CMD        "$PMTK220,1000"  // Fix interval (1000 ms = 1 Hz)
+#define NMEA_FIXINT_5HZ_CMD    "$PMTK220,200"   // Fix interval (200 ms = 5 Hz)
+#define NMEA_FIXINT_10HZ_CMD   "$PMTK220,100"   // Fix interval (100 ms = 10 Hz)
+#define NMEA_ENABLE_PPS_SYNC   "$PMTK255,1"     // Enable PPS Sync
+#define NMEA_DISABLE_PPS_SYNC  "$PMTK255,0"     // Disable PPS Sync
 
 #define SAFE_STRNCPY(dest, src, size) \
     do { \
@@ -73,83 +62,134 @@
     bool valid;         // true if time was parsed successfully
 } TimeStruct;
 
-extern TimeStruct UTC_time;
 
-/* GNSS Data Structure */
+/* GNSS Data Structure, one epoch, trimmed to the sentences enabled in
+ * Kconfig. Fields read on every fix come first so they share a cache
+ * line; fixed-point position keeps the record free of doubles. */
 typedef struct 
 {
-    // Common Fields (from GGA/RMC)
-    double latitude;
-    double longitude;
-    float altitude;
+    // Common Fields (from GGA/RMC/GLL)
+    int32_t latitude;    // 1e-7 degrees, south negative
+    int32_t longitude;   // 1e-7 degrees, west negative
+#ifdef CONFIG_LC29H_NMEA_GGA
+    float altitude;      // Above mean sea level (m)
+#endif
     float speed;         // in km/h (from RMC/VTG)
     float course;        // in degrees (from RMC/VTG)
     uint8_t fix_quality;     // 0=invalid, 1=GPS, 2=DGPS, etc. (from GGA/GSA)
-    uint8_t satellites;      // Number of satellites in use (from GGA/GSA)
-    uint32_t timestamp;  // UTC time (HHMMSS.SS)
-    char date[10];       // UTC date (DDMMYY)
-#ifdef GSA
-    // Additional Fields (from other messages)
+#ifdef CONFIG_LC29H_NMEA_GGA
+    uint8_t satellites;      // Number of satellites in use (from GGA)
+#endif
+    uint8_t day;         // UTC date (from RMC/ZDA)
+    uint8_t month;
+    uint16_t year;       // Full year (e.g., 2025)
+#ifdef CONFIG_LC29H_NMEA_GSA
+    float pdop;          // Position DOP (from GSA)
     float hdop;          // Horizontal Dilution of Precision (from GSA)
     float vdop;          // Vertical DOP (from GSA)
-    float pdop;          // Position DOP (from GSA)
-    float mag_var;       // Magnetic variation (from RMC)
-    char mode_indicator; // NMEA 4.1+ mode (A=Autonomous, D=DGPS, etc.) (from GNS/RMC)
-    char nav_status[20]; // Navigation status (from GNS)
 #endif
-#ifdef GSV
-    // GSV (Satellites in View)
-    int total_sats_in_view;
-    struct {
-        int prn;         // Satellite PRN number
-        int elevation;  // Elevation in degrees
-        int azimuth;    // Azimuth in degrees
-        int snr;        // Signal-to-noise ratio (dB)
-    } sat_info[24];     // Max 24 satellites (4 per GSV sentence)
-#endif
-#ifdef GST
+#ifdef CONFIG_LC29H_NMEA_GST
     // GST (GNSS Pseudorange Errors)
     float std_latitude;  // Standard deviation of latitude error (m)
     float std_longitude; // Standard deviation of longitude error (m)
     float std_altitude;  // Standard deviation of altitude error (m)
 #endif
-#ifdef ZDA
-    // ZDA (UTC Time & Date)
-    int utc_year;        // Full year (e.g., 2025)
-    int utc_month;       // Month (1-12)
-    int utc_day;         // Day (1-31)
-    int utc_hour;        // Hour (0-23)
-    int utc_min;         // Minute (0-59)
-    int utc_sec;         // Second (0-59)
-#endif
-#ifdef GRS
+#ifdef CONFIG_LC29H_NMEA_GRS
     // GRS (GNSS Range Residuals)
-    float range_residuals[12]; // Range residuals for each satellite (m)
+    int16_t range_residuals[12]; // Range residual of each satellite (cm)
+#endif
+#ifdef CONFIG_LC29H_NMEA_GSV
+    // GSV (Satellites in View), all systems; details in gnss_sats.h
+    uint8_t total_sats_in_view;
 #endif
-    // Firmware Info
-    char firmware_version[32];
 } GNSS_Data;
 
-extern GNSS_Data *gnss_data;
+/* Receiver information that changes rarely; kept out of the per-epoch
+ * record so it is not copied with every fix */
+typedef struct 
+{
+    char firmware_version[32];
+} GNSS_Info;
 
-// NMEA Message Types
+// Copy the receiver information
+void gnss_get_info(GNSS_Info *info);
+
+/* Consistent copy of the latest complete epoch for reader threads */
+typedef struct 
+{
+    GNSS_Data data;
+    TimeStruct utc;
+    uint32_t epoch;      // Number of epochs published since boot
+    uint32_t sentences;  // BIT(NMEA_MessageType) of every sentence in the epoch
+} GNSS_Snapshot;
+
+// Copy the latest published epoch; never blocks and never blocks the parser
+void gnss_get_snapshot(GNSS_Snapshot *snapshot);
+
+/* Sentence split into fields, shared by the type detector and all parsers.
+ * Field 0 is the address (e.g. "GPGGA"); empty fields are kept with len 0 
+ * so field indexes never shift. Fields are not NUL terminated. */
+typedef struct 
+{
+    const char *sentence;            // Points at the '$'
+    uint8_t count;                   // Number of fields, address included
+    uint8_t talker;                  // NMEA_Talker, set by the dispatcher
+    uint8_t start[NMEA_MAX_FIELDS];  // Offset of each field in sentence
+    uint8_t len[NMEA_MAX_FIELDS];    // Length of each field, 0 if empty
+} NMEA_Fields;
+
+#define NMEA_FIELD(fields, n) ((fields)->sentence + (fields)->start[n])
+
+// NMEA Message Types (independent of the talker)
 typedef enum 
 {
     NMEA_UNKNOWN = 0,
-    NMEA_GPGGA,
-    NMEA_GPRMC,
-    NMEA_GPVTG,
-    NMEA_GPGSA,
-    NMEA_GPGSV,
-    NMEA_GPGLL,
-    NMEA_GPZDA,
-    NMEA_GPGST,
-    NMEA_GPGNS,
-    NMEA_GNGGA,
-    NMEA_PQVERNO,
+    NMEA_GGA,
+    NMEA_RMC,
+    NMEA_VTG,
+    NMEA_GSA,
+    NMEA_GSV,
+    NMEA_GLL,
+    NMEA_ZDA,
+    NMEA_GST,
+    NMEA_GNS,
+    NMEA_GRS,
+    NMEA_PQTMVERNO,
+    NMEA_TYPE_COUNT,
     NMEA_CHECKSUM_ERROR
 } NMEA_MessageType;
 
+// Talker IDs (first two characters of the address)
+typedef enum 
+{
+    NMEA_TALKER_UNKNOWN = 0,
+    NMEA_TALKER_GP,            // GPS
+    NMEA_TALKER_GL,            // GLONASS
+    NMEA_TALKER_GA,            // Galileo
+    NMEA_TALKER_GB,            // BeiDou (GB or BD)
+    NMEA_TALKER_GQ,            // QZSS
+    NMEA_TALKER_GI,            // NavIC
+    NMEA_TALKER_GN,            // Combined solution
+    NMEA_TALKER_PROPRIETARY    // $P... sentences
+} NMEA_Talker;
+
+/* Dispatch keys: the 3-character sentence code packed into an integer.
+ * Proprietary sentences add their address length in the top byte and use
+ * the last three characters; the full name is compared on a match. */
+#define NMEA_KEY(a, b, c) (((uint32_t)(a) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(c))
+#define NMEA_PKEY_N(len, a, b, c) (((uint32_t)(len) << 24) | NMEA_KEY(a, b, c))
+
+typedef void (*NMEA_Parser)(const NMEA_Fields *fields);
+
+typedef struct 
+{
+    uint32_t key;           // NMEA_KEY / NMEA_PKEY_N
+    const char *name;       // Full address for proprietary sentences, else NULL
+    NMEA_MessageType type;
+    NMEA_Parser parse;
+    uint8_t time_field;     // Field holding the epoch UTC time, 0 if none
+} NMEA_Handler;
+
 typedef struct 
 {
     uint8_t hours;
@@ -164,8 +204,42 @@ typedef struct
     uint16_t year;  // 2-digit or 4-digit year depending on needs
 } NMEA_Date;
 
+#ifdef CONFIG_LC29H_RX_PROFILE
+/* Receive path profile (see CONFIG_LC29H_RX_PROFILE) */
+struct gnss_rx_profile 
+{
+    uint32_t isr_entries;     // UART interrupt / async callback entries
+    uint32_t isr_cycles;      // Cycles spent in those entries
+    uint32_t parser_wakeups;  // Parser thread wakeups given
+    uint32_t parser_runs;     // Parser passes over the ring
+    uint32_t budget_stops;    // Passes cut short by LC29H_PARSER_BUDGET_US
+    uint32_t sentences;       // Sentences handed to nmea_processing
+    uint32_t parse_cycles;    // Cycles spent framing and parsing
+};
+
+void gnss_rx_profile_get(struct gnss_rx_profile *profile, bool reset);
+#endif
+
+// Split a sentence into fields and verify its checksum; _EMPTY on success
+uint8_t nmea_tokenize(const char *sentence, size_t len, NMEA_Fields *fields);
+NMEA_MessageType nmea_get_message_type(NMEA_Fields *fields);
+
+// Process one sentence of len bytes; it need not be NUL terminated
+void nmea_process_sentence(const char *sentence, size_t len);
+// Dispatch a sentence already split and checksummed (by the framer)
+void nmea_process_fields(NMEA_Fields *fields);
+// Count a sentence that failed with NMEA_CHECKSUM_ERROR or NMEA_MESSAGE_ERR
+void nmea_reject_sentence(uint8_t error);
 void nmea_processing(const char *message);
-int send_nmea_message(const char *sentence);
+/* Sentences framed since boot that passed and failed tokenizing; kept
+ * without CONFIG_LC29H_STATS to tell a matching baud rate from noise */
+void nmea_link_counts(uint32_t *valid, uint32_t *invalid);
+// Queue "$<body>*hh\r\n" for the receiver without waiting; see nmea_tx.h
+int send_nmea_message(const char *body);
 void nmea_init(void);
+#ifdef CONFIG_LC29H_NMEA_BENCH
+// Benchmarks: while set, closed epochs are not published, stored or notified
+void nmea_isolate(bool isolate);
+#endif
 #endif
 
@@ -0,0 +1,542 @@
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <stdlib.h>
+#include <zephyr/sys/ring_buffer.h>
+#include "nmea.h"
+#include "nmea_scan.h"
+#include "nmea_framer.h"
+#include "nmea_bench.h"
+#ifdef CONFIG_LC29H_NMEA_GSV
+#include "gnss_sats.h"
+#endif
+#ifdef CONFIG_LC29H_STATS
+#include "gnss_stats.h"
+#endif
+#ifdef CONFIG_LC29H_TRACK
+#include "gnss_track.h"
+#endif
+
+#define BENCH_ROUNDS 200
+
+/* Representative LC29H(AA) output, northern and southern hemisphere */
+static const char *const bench_corpus[] =
+{
+    "$GNRMC,101523.000,A,5230.796133,N,01322.482191,E,0.04,211.52,161026,,,A,V*05\r\n",
+    "$GNGGA,101523.000,5230.796133,N,01322.482191,E,1,14,0.71,48.307,M,39.818,M,,*4E\r\n",
+    "$GNVTG,211.52,T,,M,0.04,N,0.07,K,A*25\r\n",
+    "$GNGLL,5230.796133,N,01322.482191,E,101523.000,A,A*4B\r\n",
+    "$GNRMC,101524.000,A,5230.796141,N,01322.482230,E,0.11,58.76,161026,,,A,V*32\r\n",
+    "$GNGGA,101524.000,5230.796141,N,01322.482230,E,1,14,0.71,48.291,M,39.818,M,,*4A\r\n",
+    "$GNVTG,58.76,T,,M,0.11,N,0.20,K,A*1D\r\n",
+    "$GNGLL,5230.796141,N,01322.482230,E,101524.000,A,A*41\r\n",
+    "$GNRMC,101525.000,A,3404.704178,S,07044.396627,W,12.47,97.10,161026,,,D,V*09\r\n",
+    "$GNGGA,101525.000,3404.704178,S,07044.396627,W,2,13,1.00,495.144,M,29.200,M,,*79\r\n",
+    "$GNVTG,97.10,T,,M,12.47,N,23.09,K,D*11\r\n",
+    "$GNGLL,3404.704178,S,07044.396627,W,101525.000,A,D*49\r\n",
+};
+
+// Field classes and their positions per sentence type
+typedef struct
+{
+    const char *code;
+    uint8_t coord[2];
+    uint8_t time;
+    uint8_t decimal[3];
+} BenchLayout;
+
+static const BenchLayout bench_layouts[] =
+{
+    { "GGA", { 2, 4 }, 1, { 8, 9, 11 } },
+    { "RMC", { 3, 5 }, 1, { 7, 8, 0 } },
+    { "GLL", { 1, 3 }, 5, { 0, 0, 0 } },
+    { "VTG", { 0, 0 }, 0, { 1, 5, 7 } },
+};
+
+// Reference: the atof based conversion the parsers used before
+static double bench_atof_coord(const char *token)
+{
+    double nmea_coord = atof(token);
+    int degrees = (int)(nmea_coord / 100);
+    double minutes = nmea_coord - (degrees * 100);
+    return degrees + (minutes / 60.0);
+}
+
+// Reference: the strncpy/atoi time conversion the parsers used before
+static uint32_t bench_atoi_time(const char *time_str)
+{
+    char buffer[3] = {0};
+
+    strncpy(buffer, time_str, 2);
+    uint32_t hours = atoi(buffer);
+    strncpy(buffer, time_str + 2, 2);
+    uint32_t minutes = atoi(buffer);
+    strncpy(buffer, time_str + 4, 2);
+    uint32_t seconds = atoi(buffer);
+
+    return ((hours * 60 + minutes) * 60 + seconds) * 1000;
+}
+
+typedef struct
+{
+    uint32_t fields;
+    uint32_t ref_cycles;
+    uint32_t scan_cycles;
+    uint32_t mismatches;
+} BenchResult;
+
+static void bench_print(const char *name, const BenchResult *res)
+{
+    if (res->fields == 0)
+    {
+        return;
+    }
+    printk("%-8s %5u fields  atof %6u ns/field  scan %6u ns/field  mismatches %u\n", name,
+           res->fields,
+           (uint32_t)(k_cyc_to_ns_floor64(res->ref_cycles) / res->fields),
+           (uint32_t)(k_cyc_to_ns_floor64(res->scan_cycles) / res->fields),
+           res->mismatches);
+}
+
+static void bench_scan(void)
+{
+    BenchResult coord = {0}, time = {0}, decimal = {0};
+    volatile double sink_d;
+    volatile float sink_f;
+    volatile uint32_t sink_u;
+
+    for (size_t i = 0; i < ARRAY_SIZE(bench_corpus); i++)
+    {
+        NMEA_Fields fields;
+        const BenchLayout *layout = NULL;
+
+        if (nmea_tokenize(bench_corpus[i], strlen(bench_corpus[i]), &fields) != _EMPTY)
+        {
+            printk("bench: bad corpus sentence %zu\n", i);
+            continue;
+        }
+
+        // Match on the sentence code so disabled parsers are measured too
+        for (size_t l = 0; l < ARRAY_SIZE(bench_layouts); l++)
+        {
+            if ((fields.len[0] == 5) &&
+                (memcmp(NMEA_FIELD(&fields, 0) + 2, bench_layouts[l].code, 3) == 0))
+            {
+                layout = &bench_layouts[l];
+            }
+        }
+        if (layout == NULL)
+        {
+            continue;
+        }
+
+        for (int c = 0; c < 2 && layout->coord[c] != 0; c++)
+        {
+            const char *token = NMEA_FIELD(&fields, layout->coord[c]);
+            uint8_t len = fields.len[layout->coord[c]];
+            int32_t deg_e7;
+            uint32_t start;
+
+            start = k_cycle_get_32();
+            for (int r = 0; r < BENCH_ROUNDS; r++)
+            {
+                sink_d = bench_atof_coord(token);
+            }
+            coord.ref_cycles += k_cycle_get_32() - start;
+
+            start = k_cycle_get_32();
+            for (int r = 0; r < BENCH_ROUNDS; r++)
+            {
+                nmea_scan_coord(token, len, &deg_e7);
+            }
+            coord.scan_cycles += k_cycle_get_32() - start;
+            coord.fields += BENCH_ROUNDS;
+
+            // Off by one only when the exact value is a tie the double path rounds down
+            int32_t ref = (int32_t)(bench_atof_coord(token) * 1e7 + 0.5);
+            if (abs(ref - deg_e7) > 1)
+            {
+                coord.mismatches++;
+            }
+        }
+
+        if (layout->time != 0)
+        {
+            const char *token = NMEA_FIELD(&fields, layout->time);
+            uint8_t len = fields.len[layout->time];
+            uint32_t ms;
+            uint32_t start;
+
+            start = k_cycle_get_32();
+            for (int r = 0; r < BENCH_ROUNDS; r++)
+            {
+                sink_u = bench_atoi_time(token);
+            }
+            time.ref_cycles += k_cycle_get_32() - start;
+
+            start = k_cycle_get_32();
+            for (int r = 0; r < BENCH_ROUNDS; r++)
+            {
+                nmea_scan_time(token, len, &ms);
+            }
+            time.scan_cycles += k_cycle_get_32() - start;
+            time.fields += BENCH_ROUNDS;
+
+            // The old path dropped milliseconds; compare whole seconds
+            if (bench_atoi_time(token) != ms - ms % 1000)
+            {
+                time.mismatches++;
+            }
+        }
+
+        for (int d = 0; d < 3 && layout->decimal[d] != 0; d++)
+        {
+            const char *token = NMEA_FIELD(&fields, layout->decimal[d]);
+            uint8_t len = fields.len[layout->decimal[d]];
+            float value = 0;
+            uint32_t start;
+
+            if (len == 0)
+            {
+                continue;
+            }
+
+            start = k_cycle_get_32();
+            for (int r = 0; r < BENCH_ROUNDS; r++)
+            {
+                sink_f = atof(token);
+            }
+            decimal.ref_cycles += k_cycle_get_32() - start;
+
+            start = k_cycle_get_32();
+            for (int r = 0; r < BENCH_ROUNDS; r++)
+            {
+                nmea_scan_float(token, len, &value);
+            }
+            decimal.scan_cycles += k_cycle_get_32() - start;
+            decimal.fields += BENCH_ROUNDS;
+
+            float ref = atof(token);
+            if (memcmp(&ref, &value, sizeof(value)) != 0)
+            {
+                decimal.mismatches++;
+            }
+        }
+    }
+
+    ARG_UNUSED(sink_d);
+    ARG_UNUSED(sink_f);
+    ARG_UNUSED(sink_u);
+
+    printk("NMEA numeric scan benchmark (%zu sentences, %u rounds)\n",
+           ARRAY_SIZE(bench_corpus), BENCH_ROUNDS);
+    bench_print("coord", &coord);
+    bench_print("time", &time);
+    bench_print("decimal", &decimal);
+}
+
+/* GNSS_Data as it was before the compact layout, with every sentence
+ * enabled, kept here only to measure the difference */
+typedef struct
+{
+    double latitude;
+    double longitude;
+    float altitude;
+    float speed;
+    float course;
+    uint8_t fix_quality;
+    uint8_t satellites;
+    uint32_t timestamp;
+    char date[10];
+    float hdop;
+    float vdop;
+    float pdop;
+    float mag_var;
+    char mode_indicator;
+    char nav_status[20];
+    int total_sats_in_view;
+    struct {
+        int prn;
+        int elevation;
+        int azimuth;
+        int snr;
+    } sat_info[24];
+    float std_latitude;
+    float std_longitude;
+    float std_altitude;
+    int utc_year;
+    int utc_month;
+    int utc_day;
+    int utc_hour;
+    int utc_min;
+    int utc_sec;
+    float range_residuals[12];
+    char firmware_version[32];
+} BenchLegacyData;
+
+#define BENCH_COPY_ROUNDS 1000
+
+static uint32_t bench_copy(void *dst, const void *src, size_t size)
+{
+    uint32_t start = k_cycle_get_32();
+
+    for (int r = 0; r < BENCH_COPY_ROUNDS; r++)
+    {
+        memcpy(dst, src, size);
+        __asm__ volatile("" : : "r"(dst) : "memory");  // Keep every copy
+    }
+    return k_cycle_get_32() - start;
+}
+
+// Size and copy cost of one epoch record, legacy vs current layout
+static void bench_layout(void)
+{
+    static BenchLegacyData legacy[2];
+    static GNSS_Data current[2];
+
+    uint32_t legacy_cycles = bench_copy(&legacy[0], &legacy[1], sizeof(legacy[0]));
+    uint32_t current_cycles = bench_copy(&current[0], &current[1], sizeof(current[0]));
+
+    printk("GNSS record layout (%u copies)\n", BENCH_COPY_ROUNDS);
+    printk("%-8s %5zu bytes  copy %6u ns\n", "legacy", sizeof(BenchLegacyData),
+           (uint32_t)(k_cyc_to_ns_floor64(legacy_cycles) / BENCH_COPY_ROUNDS));
+    printk("%-8s %5zu bytes  copy %6u ns\n", "current", sizeof(GNSS_Data),
+           (uint32_t)(k_cyc_to_ns_floor64(current_cycles) / BENCH_COPY_ROUNDS));
+}
+
+/* Recorded-format LC29H(AA) output, 10 Hz, GPS/GLONASS/Galileo/BeiDou/QZSS
+ * (corpus/lc29h_multi_gnss.nmea, embedded at build time) */
+static const uint8_t replay_corpus[] =
+{
+#include "lc29h_multi_gnss.nmea.inc"
+};
+
+#define REPLAY_CHUNK    64   // One DMA buffer, as delivered by the UART
+#define REPLAY_EPOCHS_MAX 64
+
+RING_BUF_DECLARE(replay_ring, 256);
+
+// Start offset of every epoch in the corpus (each epoch starts with RMC)
+static uint32_t replay_epoch[REPLAY_EPOCHS_MAX + 1];
+static uint32_t replay_epochs;
+
+static void replay_index(void)
+{
+    replay_epochs = 0;
+    for (uint32_t i = 0; i + 6 <= sizeof(replay_corpus); i++)
+    {
+        const uint8_t *p = &replay_corpus[i];
+
+        if ((p[0] == '$') && (p[3] == 'R') && (p[4] == 'M') && (p[5] == 'C') &&
+            (replay_epochs < REPLAY_EPOCHS_MAX))
+        {
+            replay_epoch[replay_epochs++] = i;
+        }
+    }
+    replay_epoch[replay_epochs] = sizeof(replay_corpus);
+}
+
+// Push bytes through the ring buffer and framer exactly as the parser thread does
+static uint32_t replay_feed(const uint8_t *data, size_t len, uint32_t *sentences)
+{
+    uint32_t start = k_cycle_get_32();
+
+    while (len > 0)
+    {
+        uint32_t put = ring_buf_put(&replay_ring, data, MIN(len, REPLAY_CHUNK));
+
+        data += put;
+        len -= put;
+        *sentences += nmea_framer_process(&replay_ring, 0);
+    }
+    return k_cycle_get_32() - start;
+}
+
+// Whole corpus as fast as possible: throughput of the complete pipeline
+static void bench_replay_throughput(void)
+{
+    uint32_t sentences = 0;
+    uint32_t cycles = replay_feed(replay_corpus, sizeof(replay_corpus), &sentences);
+    uint64_t ns = k_cyc_to_ns_floor64(cycles);
+
+    if ((sentences == 0) || (ns == 0))
+    {
+        printk("replay: no sentences framed\n");
+        return;
+    }
+    printk("NMEA replay (%zu bytes, %u sentences, %u epochs)\n",
+           sizeof(replay_corpus), sentences, replay_epochs);
+    printk("%-12s %8u sentences/s  %6u cycles/sentence\n", "pipeline",
+           (uint32_t)(sentences * 1000000000ull / ns), cycles / sentences);
+}
+
+// Tokenize + dispatch + parse cost of each sentence type
+static void bench_replay_parsers(void)
+{
+    static const char *const names[NMEA_TYPE_COUNT] =
+    {
+        [NMEA_UNKNOWN] = "unknown", [NMEA_GGA] = "GGA", [NMEA_RMC] = "RMC",
+        [NMEA_VTG] = "VTG", [NMEA_GSA] = "GSA", [NMEA_GSV] = "GSV",
+        [NMEA_GLL] = "GLL", [NMEA_ZDA] = "ZDA", [NMEA_GST] = "GST",
+        [NMEA_GNS] = "GNS", [NMEA_GRS] = "GRS", [NMEA_PQTMVERNO] = "PQTMVERNO",
+    };
+    uint32_t count[NMEA_TYPE_COUNT] = {0};
+    uint32_t cycles[NMEA_TYPE_COUNT] = {0};
+    const char *pos = (const char *)replay_corpus;
+    const char *end = pos + sizeof(replay_corpus);
+
+    while (pos < end)
+    {
+        const char *eol = memchr(pos, '\n', end - pos);
+        size_t len = (eol != NULL) ? (size_t)(eol - pos + 1) : (size_t)(end - pos);
+        NMEA_Fields fields;
+        NMEA_MessageType type = NMEA_UNKNOWN;
+
+        if (nmea_tokenize(pos, len, &fields) == _EMPTY)
+        {
+            type = nmea_get_message_type(&fields);
+        }
+
+        uint32_t start = k_cycle_get_32();
+        nmea_process_sentence(pos, len);
+        cycles[type] += k_cycle_get_32() - start;
+        count[type]++;
+
+        pos += len;
+    }
+
+    for (int type = 0; type < NMEA_TYPE_COUNT; type++)
+    {
+        if (count[type] != 0)
+        {
+            printk("%-12s %8u sentences   %6u ns/sentence\n", names[type], count[type],
+                   (uint32_t)(k_cyc_to_ns_floor64(cycles[type]) / count[type]));
+        }
+    }
+}
+
+// Corpus epochs paced at rate_hz, as the receiver would deliver them
+static void bench_replay_paced(uint32_t rate_hz)
+{
+    uint32_t period_ms = 1000 / rate_hz;
+    uint32_t epochs = MIN(replay_epochs, CONFIG_LC29H_NMEA_BENCH_EPOCHS);
+    uint32_t sentences = 0;
+    uint32_t busy = 0;
+    uint32_t worst = 0;
+    int64_t start = k_uptime_get();
+
+    for (uint32_t e = 0; e < epochs; e++)
+    {
+        uint32_t cycles = replay_feed(&replay_corpus[replay_epoch[e]],
+                                      replay_epoch[e + 1] - replay_epoch[e], &sentences);
+
+        busy += cycles;
+        worst = MAX(worst, cycles);
+        k_sleep(K_TIMEOUT_ABS_MS(start + (int64_t)(e + 1) * period_ms));
+    }
+
+    uint64_t elapsed_ns = (uint64_t)(k_uptime_get() - start) * 1000000ull;
+    if (elapsed_ns == 0)
+    {
+        return;
+    }
+    printk("%2u Hz %5u sentences/s  load %3u.%02u %%  worst epoch %6u us\n", rate_hz,
+           (uint32_t)(sentences * 1000000000ull / elapsed_ns),
+           (uint32_t)(k_cyc_to_ns_floor64(busy) * 100 / elapsed_ns),
+           (uint32_t)(k_cyc_to_ns_floor64(busy) * 10000 / elapsed_ns % 100),
+           (uint32_t)(k_cyc_to_ns_floor64(worst) / 1000));
+}
+
+static void bench_replay_thread(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    replay_index();
+    nmea_framer_reset();
+
+    bench_replay_throughput();
+    bench_replay_parsers();
+    bench_replay_paced(1);
+    bench_replay_paced(5);
+    bench_replay_paced(10);
+}
+
+// Run the replay in its own thread, at the parser's priority, so its stack
+// high-water mark is the pipeline's
+static K_THREAD_STACK_DEFINE(bench_stack, CONFIG_LC29H_NMEA_BENCH_STACK_SIZE);
+static struct k_thread bench_thread;
+
+static void bench_replay(void)
+{
+    size_t unused = 0;
+
+    // The corpus fixes stay in the parser: no snapshot, history, track or event
+    nmea_isolate(true);
+    k_thread_create(&bench_thread, bench_stack, K_THREAD_STACK_SIZEOF(bench_stack),
+                    bench_replay_thread, NULL, NULL, NULL,
+                    CONFIG_LC29H_PARSER_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&bench_thread, "nmea_bench");
+    k_thread_join(&bench_thread, K_FOREVER);
+    nmea_isolate(false);
+
+    if (k_thread_stack_space_get(&bench_thread, &unused) == 0)
+    {
+        printk("%-12s %8zu bytes peak of %u\n", "stack",
+               K_THREAD_STACK_SIZEOF(bench_stack) - unused,
+               CONFIG_LC29H_NMEA_BENCH_STACK_SIZE);
+    }
+}
+
+#ifdef CONFIG_LC29H_TRACK
+static int bench_track_fix(const struct gnss_history_fix *fix, void *user_data)
+{
+    ARG_UNUSED(fix);
+    (*(uint32_t *)user_data)++;
+    return 0;
+}
+
+// Read back the track log; the benchmark never writes to it
+static void bench_track(void)
+{
+    struct gnss_track_usage usage;
+    uint32_t fixes = 0;
+    uint32_t start = k_cycle_get_32();
+
+    if (gnss_track_replay(bench_track_fix, &fixes) != 0)
+    {
+        printk("Track log not mounted\n");
+        return;
+    }
+    uint32_t cycles = k_cycle_get_32() - start;
+
+    gnss_track_usage(&usage);
+    printk("%-12s %8u us to replay %u fixes\n", "track",
+           (uint32_t)(k_cyc_to_ns_floor64(cycles) / 1000), fixes);
+    printk("Track log: %u pages, %u fixes, %u of %u bytes, %u dropped\n",
+           usage.pages, usage.fixes, usage.bytes, usage.capacity, usage.dropped);
+}
+#endif
+
+void nmea_bench_run(void)
+{
+    bench_scan();
+    bench_layout();
+    bench_replay();
+#ifdef CONFIG_LC29H_TRACK
+    bench_track();
+#endif
+    printk("NMEA benchmark done\n");
+
+    // Leave no trace of the corpus for the application
+    nmea_framer_reset();
+    nmea_init();
+#ifdef CONFIG_LC29H_NMEA_GSV
+    gnss_sats_clear();
+#endif
+#ifdef CONFIG_LC29H_STATS
+    struct gnss_stats stats;
+
+    gnss_stats_get(&stats, true);
+#endif
+}
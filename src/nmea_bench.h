@@ -0,0 +1,7 @@
+#ifndef _NMEA_BENCH_H_
+#define _NMEA_BENCH_H_
+
+// Run the NMEA benchmarks and print the results (CONFIG_LC29H_NMEA_BENCH)
+void nmea_bench_run(void);
+
+#endif
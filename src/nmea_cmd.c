@@ -0,0 +1,297 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/slist.h>
+#include <errno.h>
+#include <string.h>
+#include "nmea.h"
+#include "nmea_scan.h"
+#include "nmea_cmd.h"
+
+LOG_MODULE_REGISTER(nmea_cmd, CONFIG_LOG_DEFAULT_LEVEL);
+
+/* PAIR001 results */
+#define PAIR_ACK_OK          0
+#define PAIR_ACK_PROCESSING  1
+#define PAIR_ACK_FAILED      2
+#define PAIR_ACK_UNSUPPORTED 3
+#define PAIR_ACK_PARAMETER   4
+#define PAIR_ACK_BUSY        5
+
+static sys_slist_t cmd_pending = SYS_SLIST_STATIC_INIT(&cmd_pending);
+static struct k_spinlock cmd_lock;
+
+static void cmd_timer_cb(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(cmd_timer, cmd_timer_cb);
+
+// Length of the address ("PAIR062") at the start of the body
+static size_t cmd_address(const char *body, const char **addr)
+{
+    if (*body == '$') 
+    {
+        body++;
+    }
+    *addr = body;
+    return strcspn(body, ",");
+}
+
+static bool cmd_matches(const struct nmea_cmd *cmd, const char *addr, size_t len)
+{
+    const char *cmd_addr;
+
+    return (cmd_address(cmd->body, &cmd_addr) == len) && (memcmp(cmd_addr, addr, len) == 0);
+}
+
+// Arm the timer for the earliest deadline; lock held
+static void cmd_timer_update(void)
+{
+    struct nmea_cmd *cmd;
+    int64_t earliest = INT64_MAX;
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&cmd_pending, cmd, node) 
+    {
+        earliest = MIN(earliest, cmd->deadline);
+    }
+
+    if (earliest == INT64_MAX) 
+    {
+        k_work_cancel_delayable(&cmd_timer);
+    }
+    else 
+    {
+        k_work_reschedule(&cmd_timer, K_TIMEOUT_ABS_MS(earliest));
+    }
+}
+
+static int cmd_send(struct nmea_cmd *cmd)
+{
+    cmd->attempts++;
+    cmd->deadline = k_uptime_get() + cmd->timeout_ms;
+    return send_nmea_message(cmd->body);
+}
+
+// Unlink and report; called without the lock
+static void cmd_complete(struct nmea_cmd *cmd, int result, const NMEA_Fields *response)
+{
+    cmd->result = result;
+    if (result != 0) 
+    {
+        LOG_WRN("%s failed (%d) after %u attempts", cmd->body, result, cmd->attempts);
+    }
+    if (cmd->cb != NULL) 
+    {
+        cmd->cb(cmd, result, response);
+    }
+    k_sem_give(&cmd->done);
+}
+
+void nmea_cmd_init(struct nmea_cmd *cmd, const char *body, nmea_cmd_cb cb, void *user_data)
+{
+    memset(cmd, 0, sizeof(*cmd));
+    cmd->body = body;
+    cmd->cb = cb;
+    cmd->user_data = user_data;
+    cmd->timeout_ms = CONFIG_LC29H_CMD_TIMEOUT_MS;
+    cmd->retries = CONFIG_LC29H_CMD_RETRIES;
+    cmd->result = -EINPROGRESS;
+}
+
+int nmea_cmd_submit(struct nmea_cmd *cmd)
+{
+    const char *addr;
+    size_t len = cmd_address(cmd->body, &addr);
+    int ret;
+
+    k_spinlock_key_t key = k_spin_lock(&cmd_lock);
+
+    if (sys_slist_find(&cmd_pending, &cmd->node, NULL)) 
+    {
+        k_spin_unlock(&cmd_lock, key);
+        return -EBUSY;
+    }
+
+    cmd->number = 0;
+    if ((len > 4) && (memcmp(addr, "PAIR", 4) == 0)) 
+    {
+        uint32_t number;
+
+        if (nmea_scan_uint(addr + 4, len - 4, &number)) 
+        {
+            cmd->number = number;
+        }
+    }
+    cmd->attempts = 0;
+    cmd->result = -EINPROGRESS;
+    k_sem_init(&cmd->done, 0, 1);
+
+    // Send and track under the lock: the answer may be parsed before we return
+    ret = cmd_send(cmd);
+    if (ret == 0) 
+    {
+        sys_slist_append(&cmd_pending, &cmd->node);
+        cmd_timer_update();
+    }
+    k_spin_unlock(&cmd_lock, key);
+    return ret;
+}
+
+int nmea_cmd_wait(struct nmea_cmd *cmd, k_timeout_t timeout)
+{
+    if (k_sem_take(&cmd->done, timeout) != 0) 
+    {
+        return -EAGAIN;
+    }
+    return cmd->result;
+}
+
+void nmea_cmd_cancel(struct nmea_cmd *cmd)
+{
+    k_spinlock_key_t key = k_spin_lock(&cmd_lock);
+
+    sys_slist_find_and_remove(&cmd_pending, &cmd->node);
+    cmd_timer_update();
+    k_spin_unlock(&cmd_lock, key);
+}
+
+int nmea_cmd_send(const char *body)
+{
+    struct nmea_cmd cmd;
+    int ret;
+
+    nmea_cmd_init(&cmd, body, NULL, NULL);
+    ret = nmea_cmd_submit(&cmd);
+    if (ret != 0) 
+    {
+        return ret;
+    }
+
+    // Bounded by the timeout and retries; cmd must outlive the tracker's use
+    return nmea_cmd_wait(&cmd, K_FOREVER);
+}
+
+// Resend timed out commands, fail those out of attempts
+static void cmd_timer_cb(struct k_work *work)
+{
+    struct nmea_cmd *cmd;
+    struct nmea_cmd *next;
+    sys_slist_t expired;
+    int64_t now = k_uptime_get();
+
+    sys_slist_init(&expired);
+
+    k_spinlock_key_t key = k_spin_lock(&cmd_lock);
+
+    SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&cmd_pending, cmd, next, node) 
+    {
+        if (cmd->deadline > now) 
+        {
+            continue;
+        }
+        if ((cmd->attempts <= cmd->retries) && (cmd_send(cmd) == 0)) 
+        {
+            LOG_DBG("Resending %s", cmd->body);
+            continue;
+        }
+        sys_slist_find_and_remove(&cmd_pending, &cmd->node);
+        sys_slist_append(&expired, &cmd->node);
+    }
+    cmd_timer_update();
+    k_spin_unlock(&cmd_lock, key);
+
+    SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&expired, cmd, next, node) 
+    {
+        cmd_complete(cmd, -ETIMEDOUT, NULL);
+    }
+}
+
+static int cmd_ack_result(uint32_t ack)
+{
+    switch (ack) 
+    {
+        case PAIR_ACK_OK:          return 0;
+        case PAIR_ACK_UNSUPPORTED: return -ENOTSUP;
+        case PAIR_ACK_PARAMETER:   return -EINVAL;
+        default:                   return -EIO;
+    }
+}
+
+void nmea_cmd_response(const NMEA_Fields *fields)
+{
+    const char *addr = NMEA_FIELD(fields, 0);
+    uint8_t len = fields->len[0];
+    struct nmea_cmd *cmd;
+    struct nmea_cmd *found = NULL;
+    int result = 0;
+    bool ack;
+    uint32_t number = 0;
+    uint32_t ack_result = PAIR_ACK_OK;
+
+    if (sys_slist_is_empty(&cmd_pending)) 
+    {
+        return;
+    }
+
+    ack = (len == 7) && (memcmp(addr, "PAIR001", 7) == 0);
+    if (ack) 
+    {
+        if ((fields->count < 3) ||
+            !nmea_scan_uint(NMEA_FIELD(fields, 1), fields->len[1], &number) ||
+            !nmea_scan_uint(NMEA_FIELD(fields, 2), fields->len[2], &ack_result)) 
+        {
+            return;
+        }
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&cmd_lock);
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&cmd_pending, cmd, node) 
+    {
+        if (ack ? ((cmd->number == number) && (number != 0)) : cmd_matches(cmd, addr, len)) 
+        {
+            found = cmd;
+            break;
+        }
+    }
+
+    if (found == NULL) 
+    {
+        k_spin_unlock(&cmd_lock, key);
+        return;
+    }
+
+    if (ack) 
+    {
+        if ((ack_result == PAIR_ACK_PROCESSING) ||
+            ((ack_result == PAIR_ACK_OK) && found->query)) 
+        {
+            // Keep waiting, for the outcome or the query data
+            found->deadline = k_uptime_get() + found->timeout_ms;
+            cmd_timer_update();
+            k_spin_unlock(&cmd_lock, key);
+            return;
+        }
+        if ((ack_result == PAIR_ACK_BUSY) && (found->attempts <= found->retries)) 
+        {
+            // Resend from the timer after one timeout
+            k_spin_unlock(&cmd_lock, key);
+            return;
+        }
+        result = cmd_ack_result(ack_result);
+    }
+    else if ((fields->count > 1) && (fields->len[1] == 5) &&
+             (memcmp(NMEA_FIELD(fields, 1), "ERROR", 5) == 0)) 
+    {
+        result = -EIO;
+    }
+    else if ((found->number != 0) && !found->query) 
+    {
+        // PAIR data sentence for a set command: the ACK decides
+        k_spin_unlock(&cmd_lock, key);
+        return;
+    }
+
+    sys_slist_find_and_remove(&cmd_pending, &found->node);
+    cmd_timer_update();
+    k_spin_unlock(&cmd_lock, key);
+
+    cmd_complete(found, result, fields);
+}
@@ -0,0 +1,72 @@
+#ifndef _NMEA_CMD_H_
+#define _NMEA_CMD_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+#include "nmea.h"
+
+/* Command tracker (CONFIG_LC29H_CMD). A submitted command stays pending
+ * until the parser sees its answer:
+ *
+ *   $PAIRnnn,...     $PAIR001,nnn,<result>, or for a query the
+ *                    $PAIRnnn,... data sentence that follows the ACK
+ *   $PQTMxxx,...     $PQTMxxx,... ("ERROR" in field 1 fails it)
+ *
+ * Each attempt times out after timeout_ms and is resent up to retries
+ * times, as is a command the receiver reports busy. Several commands
+ * may be pending; answers to the same command are matched in order.
+ *
+ *     static struct nmea_cmd cmd;
+ *
+ *     nmea_cmd_init(&cmd, LC29H_ENABLE_GSV, NULL, NULL);
+ *     nmea_cmd_submit(&cmd);
+ *     ...
+ *     ret = nmea_cmd_wait(&cmd, K_SECONDS(5));
+ */
+
+struct nmea_cmd;
+
+/* Called once per command with its result (0 or a negative errno) and
+ * the answering sentence (the ACK for PAIR set commands), NULL on a
+ * timeout. Runs in the parser or,
+ * on a timeout, in the system work queue; it must not block. */
+typedef void (*nmea_cmd_cb)(struct nmea_cmd *cmd, int result, const NMEA_Fields *response);
+
+struct nmea_cmd 
+{
+    sys_snode_t node;
+    const char *body;        // Sentence body, kept until completion
+    nmea_cmd_cb cb;          // Optional
+    void *user_data;
+    uint16_t timeout_ms;     // Per attempt
+    uint8_t retries;         // Resends after a timeout or busy answer
+    bool query;              // PAIR query: completes on the data sentence
+
+    // Private
+    struct k_sem done;
+    int result;              // -EINPROGRESS while pending
+    uint8_t attempts;
+    uint16_t number;         // PAIR command number, 0 for PQTM
+    int64_t deadline;
+};
+
+// Fill in the body and the default timeout and retries
+void nmea_cmd_init(struct nmea_cmd *cmd, const char *body, nmea_cmd_cb cb, void *user_data);
+
+// Send the command and start tracking it; -EBUSY if it is still pending
+int nmea_cmd_submit(struct nmea_cmd *cmd);
+
+// Wait for the result of a submitted command; -EAGAIN if still pending
+int nmea_cmd_wait(struct nmea_cmd *cmd, k_timeout_t timeout);
+
+// Stop tracking; the callback is not called
+void nmea_cmd_cancel(struct nmea_cmd *cmd);
+
+/* Submit and wait for the result, for callers that need nothing else.
+ * Returns after at most (retries + 1) * timeout_ms. */
+int nmea_cmd_send(const char *body);
+
+// Parser hook for proprietary sentences
+void nmea_cmd_response(const NMEA_Fields *fields);
+
+#endif
@@ -0,0 +1,662 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/ring_buffer.h>
+#include "nmea.h"
+#include "nmea_framer.h"
+#include "gnss_stats.h"
+#ifdef CONFIG_LC29H_DEMUX
+#include "gnss_demux.h"
+#include "rtcm3.h"
+
+// RTCM3 header and the 12 bit message number
+#define FRAMER_RTCM_PEEK (RTCM3_HEADER_LEN + 2)
+#endif
+
+/* Byte state machine:
+ *
+ *   IDLE -$-> BODY -*-> SUM_HI -hex-> SUM_LO -hex-> CR -\r-> LF -\n-> IDLE
+ *
+ * BODY splits fields at ',' and XORs the checksum as bytes arrive, so
+ * the parser gets a sentence that is already split and verified. A '$'
+ * anywhere restarts the sentence; any other unexpected byte drops it
+ * and the framer waits for the next '$'.
+ *
+ * With CONFIG_LC29H_DEMUX an RTCM3 preamble (0xD3, never part of NMEA
+ * text) starts a binary frame instead:
+ *
+ *   IDLE -0xD3-> RTCM_HEADER -4 bytes-> RTCM_BODY -rest of the frame-> IDLE
+ *
+ * The header must have its reserved bits clear and a known message
+ * number. The frame is copied to gnss_demux, '$' and '\n' included, and
+ * its CRC-24Q checked as it arrives. A preamble that turns out false
+ * (line noise, or a frame cut by a ring overrun) costs no NMEA: the
+ * bytes after it are scanned again before the ring. */
+enum framer_state
+{
+    FRAMER_IDLE,
+    FRAMER_BODY,
+    FRAMER_SUM_HI,
+    FRAMER_SUM_LO,
+    FRAMER_CR,
+    FRAMER_LF,
+    FRAMER_RTCM_HEADER,
+    FRAMER_RTCM_BODY,
+};
+
+/* The sentence is copied here as it is checked, wrapped around the ring
+ * or not. Framing in place over the ring claim copied only wrapped
+ * sentences, but needed a second pass to tokenize: 257 ns a sentence on
+ * the host against 248 ns for one pass with the copy. */
+static struct
+{
+    uint8_t state;
+    uint8_t sum;             // XOR of the body so far
+    uint8_t expected;        // High nibble of the received checksum
+    uint16_t len;
+    NMEA_Fields fields;
+    char buf[NMEA_SENTENCE_MAX_LEN];
+#ifdef CONFIG_LC29H_DEMUX
+    uint8_t rtcm_header[FRAMER_RTCM_PEEK];
+    uint8_t *rtcm;           // Frame buffer, NULL if the heap had no room
+    uint16_t rtcm_len;       // Whole frame, header to CRC
+    uint16_t rtcm_pos;       // Bytes received, preamble included
+    uint32_t rtcm_crc;       // CRC-24Q of the bytes before the CRC
+    uint32_t rtcm_rx;        // Last bytes received, the CRC once complete
+    uint8_t rtcm_false;      // FRAMER_FALSE_* of the frame just ended
+#ifdef CONFIG_LC29H_STATS
+    uint32_t rtcm_start;     // Ring position of the preamble
+#endif
+#endif
+} framer;
+
+#ifdef CONFIG_LC29H_DEMUX
+#define FRAMER_FALSE_HEADER 1
+#define FRAMER_FALSE_CRC    2
+
+BUILD_ASSERT(CONFIG_LC29H_DEMUX_RESCAN_SIZE >= FRAMER_RTCM_PEEK,
+             "LC29H_DEMUX_RESCAN_SIZE must hold an RTCM3 header");
+
+// Frame copy while the heap has no room; only its first bytes are kept
+static uint8_t framer_spill[CONFIG_LC29H_DEMUX_RESCAN_SIZE];
+
+/* Bytes after a false preamble, fed to the framer before the ring. A
+ * false frame found inside them rewinds pos rather than nesting. */
+static struct
+{
+    const uint8_t *data;
+    uint8_t *frame;          // Heap frame holding data, freed once scanned
+    uint16_t pos;
+    uint16_t len;
+    bool cut;                // Bytes after data were not kept
+#ifdef CONFIG_LC29H_STATS
+    uint32_t ring_pos;       // Ring position of data[0]
+#endif
+} rescan;
+#endif
+
+#ifdef CONFIG_LC29H_STATS
+// Bytes consumed from the ring, to match sentences with their '$' stamp
+static uint32_t framer_pos;
+static uint32_t sentence_pos;
+#define FRAMER_POS(offset) (framer_pos + (offset))
+#endif
+
+void nmea_framer_reset(void)
+{
+#ifdef CONFIG_LC29H_DEMUX
+    if ((framer.state == FRAMER_RTCM_BODY) && (framer.rtcm != NULL))
+    {
+        gnss_demux_rtcm_free(framer.rtcm);
+    }
+    if (rescan.frame != NULL)
+    {
+        gnss_demux_rtcm_free(rescan.frame);
+    }
+    memset(&rescan, 0, sizeof(rescan));
+#endif
+    framer.state = FRAMER_IDLE;
+#ifdef CONFIG_LC29H_STATS
+    framer_pos = 0;
+#endif
+}
+
+static inline void framer_finish(struct ring_buf *rb, uint32_t len)
+{
+    ring_buf_get_finish(rb, len);
+#ifdef CONFIG_LC29H_STATS
+    framer_pos += len;
+#endif
+}
+
+static inline int framer_hex(uint8_t c)
+{
+    if ((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+    if ((c >= 'A') && (c <= 'F'))
+    {
+        return c - 'A' + 10;
+    }
+    if ((c >= 'a') && (c <= 'f'))
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+static void framer_reject(uint8_t error)
+{
+    nmea_reject_sentence(error);
+    framer.state = FRAMER_IDLE;
+}
+
+// Body byte classes: copied, field separator, or end of the body run
+#define BODY_DATA  0
+#define BODY_COMMA 1
+#define BODY_STOP  2
+
+static const uint8_t body_class[256] =
+{
+    [0 ... ' ' - 1] = BODY_STOP,
+    [','] = BODY_COMMA,
+    ['*'] = BODY_STOP,
+    ['$'] = BODY_STOP,
+    [0x7F ... 0xFF] = BODY_STOP,
+};
+
+/* Body bytes from data[i]: copy, split at ',' and XOR in one tight loop,
+ * the hot path of the framer. Returns the index of the byte that ended
+ * the run (anything not printable, '*' or '$'), or len. */
+static uint32_t framer_body(const uint8_t *data, uint32_t i, uint32_t len)
+{
+    NMEA_Fields *fields = &framer.fields;
+    uint8_t sum = framer.sum;
+    uint16_t pos = framer.len;
+
+    for (; i < len; i++)
+    {
+        uint8_t c = data[i];
+        uint8_t class = body_class[c];
+
+        if ((class == BODY_STOP) || (pos == NMEA_SENTENCE_MAX_LEN))
+        {
+            break;
+        }
+        if (class == BODY_COMMA)
+        {
+            uint8_t n = fields->count - 1;
+
+            if (fields->count == NMEA_MAX_FIELDS)
+            {
+                framer_reject(NMEA_MESSAGE_ERR);
+                return i + 1;
+            }
+            fields->len[n] = pos - fields->start[n];
+            fields->start[fields->count++] = pos + 1;
+        }
+        framer.buf[pos++] = c;
+        sum ^= c;
+    }
+
+    framer.sum = sum;
+    framer.len = pos;
+    return i;
+}
+
+// Byte that ended a body run, just stored at buf[len - 1]
+static void framer_body_end(uint8_t c)
+{
+    NMEA_Fields *fields = &framer.fields;
+    uint8_t n = fields->count - 1;
+
+    if ((c == '*') && (framer.len > 2))
+    {
+        fields->len[n] = framer.len - 1 - fields->start[n];
+        framer.state = FRAMER_SUM_HI;
+        return;
+    }
+    // Line noise, or a line that ended without "*hh"
+    framer_reject(((c == '\r') || (c == '\n')) ? NMEA_CHECKSUM_ERROR : NMEA_MESSAGE_ERR);
+}
+
+// Byte after the checksum; true once the sentence is complete
+static bool framer_end(uint8_t c)
+{
+    if ((framer.state == FRAMER_CR) && (c == '\r'))
+    {
+        framer.state = FRAMER_LF;
+        return false;
+    }
+    // A bare '\n' ends the sentence as well
+    if (c != '\n')
+    {
+        framer_reject(NMEA_MESSAGE_ERR);
+        return false;
+    }
+    framer.state = FRAMER_IDLE;
+    return true;
+}
+
+// '$' at offset in the current claim
+static void framer_restart(uint32_t offset)
+{
+    framer.state = FRAMER_BODY;
+    framer.sum = 0;
+    framer.buf[0] = '$';
+    framer.len = 1;
+    framer.fields.sentence = framer.buf;
+    framer.fields.count = 1;
+    framer.fields.talker = NMEA_TALKER_UNKNOWN;
+    framer.fields.start[0] = 1;
+#ifdef CONFIG_LC29H_STATS
+    sentence_pos = FRAMER_POS(offset);
+#else
+    ARG_UNUSED(offset);
+#endif
+}
+
+#ifdef CONFIG_LC29H_DEMUX
+// Next '$' or RTCM3 preamble
+static inline const uint8_t *framer_sync(const uint8_t *data, uint32_t len)
+{
+    for (const uint8_t *end = data + len; data < end; data++)
+    {
+        if ((*data == '$') || (*data == RTCM3_PREAMBLE))
+        {
+            return data;
+        }
+    }
+    return NULL;
+}
+
+// Preamble at offset in the current bytes
+static void framer_rtcm_start(uint32_t offset)
+{
+    framer.state = FRAMER_RTCM_HEADER;
+    framer.rtcm_header[0] = RTCM3_PREAMBLE;
+    framer.rtcm_pos = 1;
+    framer.rtcm_rx = 0;
+#ifdef CONFIG_LC29H_STATS
+    framer.rtcm_start = FRAMER_POS(offset);
+#else
+    ARG_UNUSED(offset);
+#endif
+}
+
+// Header bytes so far could start a frame
+static bool framer_rtcm_plausible(void)
+{
+    const uint8_t *header = framer.rtcm_header;
+    uint16_t type;
+
+    switch (framer.rtcm_pos)
+    {
+        case 2:  // 6 reserved bits, always 0
+            return (header[1] & 0xFC) == 0;
+        case 3:  // Room for the message number
+            return (((header[1] & 0x03) << 8) | header[2]) >= 2;
+        case 5:  // Standard (1001..1299) or proprietary (4001..4095) message
+            type = (header[3] << 4) | (header[4] >> 4);
+            return ((type >= 1001) && (type <= 1299)) || (type >= 4001);
+        default:
+            return true;
+    }
+}
+
+static inline bool framer_rescanning(void)
+{
+    return rescan.pos < rescan.len;
+}
+
+/* Frame bytes at rtcm_pos: to the heap buffer, else to the spill as far
+ * as it goes. While the spill is being rescanned they are in it already,
+ * at the frame's offset; framer_rescan() moves them down when done. */
+static void framer_rtcm_keep(const uint8_t *data, uint32_t n)
+{
+    if (framer.rtcm != NULL)
+    {
+        memcpy(&framer.rtcm[framer.rtcm_pos], data, n);
+    }
+    else if ((framer.rtcm_pos < sizeof(framer_spill)) &&
+             !(framer_rescanning() && (rescan.data == framer_spill)))
+    {
+        memcpy(&framer_spill[framer.rtcm_pos], data, MIN(n, sizeof(framer_spill) - framer.rtcm_pos));
+    }
+}
+
+// The frame that just ended was not one; the caller rescans its bytes
+static void framer_rtcm_false(uint8_t reason)
+{
+    framer.state = FRAMER_IDLE;
+    framer.rtcm_false = reason;
+}
+
+// RTCM3 frame bytes from data[i]; returns the index of the first byte not used
+static uint32_t framer_rtcm(const uint8_t *data, uint32_t i, uint32_t len)
+{
+    uint32_t end;
+    uint32_t n;
+
+    if (framer.state == FRAMER_RTCM_HEADER)
+    {
+        framer.rtcm_header[framer.rtcm_pos++] = data[i];
+        if (!framer_rtcm_plausible())
+        {
+            framer_rtcm_false(FRAMER_FALSE_HEADER);
+            return i + 1;
+        }
+        if (framer.rtcm_pos < FRAMER_RTCM_PEEK)
+        {
+            return i + 1;
+        }
+
+        framer.rtcm_len = (((framer.rtcm_header[1] & 0x03) << 8) | framer.rtcm_header[2]) +
+                          RTCM3_HEADER_LEN + RTCM3_CRC_LEN;
+        framer.rtcm_crc = rtcm3_crc24q(0, framer.rtcm_header, FRAMER_RTCM_PEEK);
+        framer.rtcm = gnss_demux_rtcm_alloc(framer.rtcm_len);
+        framer.rtcm_pos = 0;
+        framer_rtcm_keep(framer.rtcm_header, FRAMER_RTCM_PEEK);
+        framer.rtcm_pos = FRAMER_RTCM_PEEK;
+        framer.state = FRAMER_RTCM_BODY;
+        return i + 1;
+    }
+
+    n = MIN(len - i, (uint32_t)(framer.rtcm_len - framer.rtcm_pos));
+    end = framer.rtcm_len - RTCM3_CRC_LEN;
+    if (framer.rtcm_pos < end)
+    {
+        framer.rtcm_crc = rtcm3_crc24q(framer.rtcm_crc, &data[i], MIN(n, end - framer.rtcm_pos));
+    }
+    for (uint32_t k = (framer.rtcm_pos < end) ? end - framer.rtcm_pos : 0; k < n; k++)
+    {
+        framer.rtcm_rx = (framer.rtcm_rx << 8) | data[i + k];
+    }
+    framer_rtcm_keep(&data[i], n);
+    framer.rtcm_pos += n;
+    if (framer.rtcm_pos < framer.rtcm_len)
+    {
+        return i + n;
+    }
+
+    if (framer.rtcm_crc != (framer.rtcm_rx & 0xFFFFFF))
+    {
+        framer_rtcm_false(FRAMER_FALSE_CRC);
+        return i + n;
+    }
+    framer.state = FRAMER_IDLE;
+    gnss_demux_rtcm_frame(framer.rtcm, framer.rtcm_len);
+    return i + n;
+}
+#else
+#define framer_sync(data, len) ((const uint8_t *)memchr((data), '$', (len)))
+#endif
+
+/* Feed bytes until one sentence is complete and parsed; returns the
+ * bytes used. Only the state machine carries over between calls. */
+static uint32_t framer_feed(const uint8_t *data, uint32_t len, uint32_t *count)
+{
+    uint32_t i = 0;
+
+    while (i < len)
+    {
+        if (framer.state == FRAMER_IDLE)
+        {
+            // Resynchronise: nothing matters before the next '$'
+            const uint8_t *start = framer_sync(&data[i], len - i);
+
+            if (start == NULL)
+            {
+                return len;
+            }
+            i = start - data;
+#ifdef CONFIG_LC29H_DEMUX
+            if (*start == RTCM3_PREAMBLE)
+            {
+                framer_rtcm_start(i++);
+                continue;
+            }
+#endif
+            framer_restart(i++);
+            continue;
+        }
+
+#ifdef CONFIG_LC29H_DEMUX
+        if (framer.state >= FRAMER_RTCM_HEADER)
+        {
+            i = framer_rtcm(data, i, len);
+            if (framer.rtcm_false)
+            {
+                return i;
+            }
+            continue;
+        }
+#endif
+
+        if (framer.state == FRAMER_BODY)
+        {
+            i = framer_body(data, i, len);
+            if ((i == len) || (framer.state != FRAMER_BODY))
+            {
+                continue;
+            }
+        }
+
+        uint8_t c = data[i];
+        int hex;
+
+        if (c == '$')
+        {
+            // Cut short by a new sentence
+            nmea_reject_sentence(NMEA_MESSAGE_ERR);
+            framer_restart(i++);
+            continue;
+        }
+#ifdef CONFIG_LC29H_DEMUX
+        if (c == RTCM3_PREAMBLE)
+        {
+            nmea_reject_sentence(NMEA_MESSAGE_ERR);
+            framer_rtcm_start(i++);
+            continue;
+        }
+#endif
+        if (framer.len == NMEA_SENTENCE_MAX_LEN)
+        {
+            GNSS_STATS_INC(overlong);
+            framer.state = FRAMER_IDLE;
+            continue;
+        }
+        framer.buf[framer.len++] = c;
+        i++;
+
+        switch (framer.state)
+        {
+            case FRAMER_BODY:
+                framer_body_end(c);
+                break;
+            case FRAMER_SUM_HI:
+                hex = framer_hex(c);
+                if (hex < 0)
+                {
+                    framer_reject(NMEA_CHECKSUM_ERROR);
+                    break;
+                }
+                framer.expected = hex << 4;
+                framer.state = FRAMER_SUM_LO;
+                break;
+            case FRAMER_SUM_LO:
+                hex = framer_hex(c);
+                if ((hex < 0) || ((framer.expected | hex) != framer.sum))
+                {
+                    framer_reject(NMEA_CHECKSUM_ERROR);
+                    break;
+                }
+                framer.state = FRAMER_CR;
+                break;
+            default:
+                if (framer_end(c))
+                {
+                    nmea_process_fields(&framer.fields);
+                    gnss_stats_parsed(sentence_pos);
+                    (*count)++;
+                    return i;
+                }
+                break;
+        }
+    }
+    return len;
+}
+
+#ifdef CONFIG_LC29H_DEMUX
+/* A preamble turned out false: scan the bytes after it again. Found
+ * while rescanning, the frame lies in the bytes being rescanned, which
+ * are rewound; otherwise its copy is rescanned, as far as it was kept. */
+static void framer_rtcm_rescan(bool rescanning)
+{
+    bool crc_error = (framer.rtcm_false == FRAMER_FALSE_CRC);
+    uint8_t *heap = crc_error ? framer.rtcm : NULL;
+    uint16_t frame = framer.rtcm_pos;   // Preamble included
+    uint16_t kept = frame;
+
+    framer.rtcm_false = 0;
+    if (rescanning)
+    {
+        rescan.pos -= frame - 1;
+        if (heap != NULL)
+        {
+            gnss_demux_rtcm_free(heap);
+        }
+    }
+    else
+    {
+        if (heap != NULL)
+        {
+            rescan.data = heap;
+        }
+        else
+        {
+            if (!crc_error)
+            {
+                memcpy(framer_spill, framer.rtcm_header, frame);
+            }
+            kept = MIN(frame, sizeof(framer_spill));
+            rescan.data = framer_spill;
+        }
+        rescan.frame = heap;
+        rescan.pos = 1;
+        rescan.len = kept;
+        rescan.cut = (kept < frame);
+#ifdef CONFIG_LC29H_STATS
+        rescan.ring_pos = framer.rtcm_start;
+#endif
+    }
+    gnss_demux_rtcm_false(crc_error, kept - 1, frame - kept);
+}
+
+// Drop the sentence or frame under way
+static void framer_drop(void)
+{
+    if (framer.state >= FRAMER_RTCM_HEADER)
+    {
+        if ((framer.state == FRAMER_RTCM_BODY) && (framer.rtcm != NULL))
+        {
+            gnss_demux_rtcm_free(framer.rtcm);
+        }
+    }
+    else if (framer.state != FRAMER_IDLE)
+    {
+        nmea_reject_sentence(NMEA_MESSAGE_ERR);
+    }
+    framer.state = FRAMER_IDLE;
+}
+
+// Feed rescanned bytes until a sentence is complete; false if there are none
+static bool framer_rescan(uint32_t *count)
+{
+    uint32_t used;
+#ifdef CONFIG_LC29H_STATS
+    uint32_t ring = framer_pos;
+#endif
+
+    if (!framer_rescanning())
+    {
+        return false;
+    }
+
+#ifdef CONFIG_LC29H_STATS
+    // Sentences found again keep the ring position of their '$'
+    framer_pos = rescan.ring_pos + rescan.pos;
+#endif
+    used = framer_feed(&rescan.data[rescan.pos], rescan.len - rescan.pos, count);
+#ifdef CONFIG_LC29H_STATS
+    framer_pos = ring;
+#endif
+    rescan.pos += used;
+
+    if (framer.rtcm_false)
+    {
+        framer_rtcm_rescan(true);
+    }
+    else if (!framer_rescanning())
+    {
+        if (rescan.frame != NULL)
+        {
+            gnss_demux_rtcm_free(rescan.frame);
+            rescan.frame = NULL;
+        }
+        if (rescan.cut)
+        {
+            // Nothing goes on across the bytes that were not kept
+            framer_drop();
+        }
+        else if ((rescan.data == framer_spill) && (framer.state == FRAMER_RTCM_BODY) &&
+                 (framer.rtcm == NULL))
+        {
+            // A frame that started in the spill goes on in the ring: its bytes to the front
+            memmove(framer_spill, &framer_spill[rescan.len - framer.rtcm_pos], framer.rtcm_pos);
+        }
+    }
+    return true;
+}
+#endif
+
+uint32_t nmea_framer_process(struct ring_buf *rb, uint32_t budget)
+{
+    uint8_t *data;
+    uint32_t len;
+    uint32_t count = 0;
+    uint32_t start = (budget != 0) ? k_cycle_get_32() : 0;
+    bool first = true;
+
+    while (true)
+    {
+        // Every pass ends on a sentence or the end of its bytes, so it may stop after any
+        if (!first && (budget != 0) && (k_cycle_get_32() - start >= budget))
+        {
+            break;
+        }
+        first = false;
+
+#ifdef CONFIG_LC29H_DEMUX
+        // Bytes after a false preamble come before the rest of the ring
+        if (framer_rescan(&count))
+        {
+            continue;
+        }
+#endif
+        len = ring_buf_get_claim(rb, &data, UINT32_MAX);
+        if (len == 0)
+        {
+            break;
+        }
+        framer_finish(rb, framer_feed(data, len, &count));
+#ifdef CONFIG_LC29H_DEMUX
+        if (framer.rtcm_false)
+        {
+            framer_rtcm_rescan(false);
+        }
+#endif
+    }
+
+    return count;
+}
@@ -0,0 +1,23 @@
+#ifndef _NMEA_FRAMER_H_
+#define _NMEA_FRAMER_H_
+
+#include <zephyr/sys/ring_buffer.h>
+
+// Longest sentence accepted, including "\r\n" (LC29H proprietary
+// sentences are longer than the 82 characters of standard NMEA)
+#define NMEA_SENTENCE_MAX_LEN 128
+
+// Frame every complete sentence currently in the ring buffer, splitting
+// its fields and checking its checksum on the way, and pass it to
+// nmea_process_fields(); bad sentences go to nmea_reject_sentence().
+// With CONFIG_LC29H_DEMUX, RTCM3 frames go to gnss_demux.
+// A sentence that has not been terminated yet stays in the framer until
+// the next call. With a budget (in cycles, 0 for
+// none) it returns early once that much time has passed, leaving the rest
+// in the ring. Returns the number of sentences framed.
+uint32_t nmea_framer_process(struct ring_buf *rb, uint32_t budget);
+
+// Drop any partially assembled sentence
+void nmea_framer_reset(void);
+
+#endif
@@ -0,0 +1,99 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/irq.h>
+#include <zephyr/sys/ring_buffer.h>
+#include "nmea.h"
+#include "nmea_framer.h"
+#include "nmea_fuzz.h"
+
+/* libFuzzer harness for native_sim (CONFIG_ARCH_POSIX_LIBFUZZER). The
+ * runner stores each input in posix_fuzz_buf and raises the fuzz IRQ;
+ * the input is processed in thread context, like received data. The
+ * first byte selects the mode, the rest is the data:
+ *
+ *   bit 0 clear  raw stream: the bytes go through the ring buffer and
+ *                framer in chunks of 1 to 64 bytes (bits 1..6), so the
+ *                wrap and resync paths see every split of a sentence
+ *   bit 0 set    sentences: each line becomes "$<line>*hh\r\n" with a
+ *                correct checksum, so mutations reach the field parsers
+ *                instead of dying at the checksum
+ */
+
+// Set by the native_sim libFuzzer runner
+extern const uint8_t *posix_fuzz_buf;
+extern size_t posix_fuzz_sz;
+
+// As small as the receive ring, so long inputs wrap it often
+RING_BUF_DECLARE(fuzz_ring, 256);
+static K_SEM_DEFINE(fuzz_sem, 0, 1);
+static char fuzz_sentence[NMEA_SENTENCE_MAX_LEN];
+
+static void fuzz_isr(const void *arg)
+{
+    ARG_UNUSED(arg);
+    k_sem_give(&fuzz_sem);
+}
+
+static void fuzz_stream(const uint8_t *data, size_t len, uint32_t chunk)
+{
+    ring_buf_reset(&fuzz_ring);
+    nmea_framer_reset();
+
+    while (len > 0)
+    {
+        uint32_t put = ring_buf_put(&fuzz_ring, data, MIN(len, chunk));
+
+        data += put;
+        len -= put;
+        nmea_framer_process(&fuzz_ring, 0);
+    }
+}
+
+static void fuzz_sentences(const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        const uint8_t *newline = memchr(data, '\n', len);
+        size_t line = (newline != NULL) ? (size_t)(newline - data) : len;
+        size_t body = MIN(line, sizeof(fuzz_sentence) - sizeof("$*hh\r\n"));
+        uint8_t checksum = 0;
+
+        fuzz_sentence[0] = '$';
+        for (size_t i = 0; i < body; i++)
+        {
+            fuzz_sentence[i + 1] = data[i];
+            checksum ^= data[i];
+        }
+        snprintk(&fuzz_sentence[body + 1], sizeof(fuzz_sentence) - body - 1, "*%02X\r\n",
+                 checksum);
+        nmea_process_sentence(fuzz_sentence, body + sizeof("$*hh\r\n") - 1);
+
+        line = MIN(line + 1, len);
+        data += line;
+        len -= line;
+    }
+}
+
+void nmea_fuzz_run(void)
+{
+    IRQ_CONNECT(CONFIG_ARCH_POSIX_FUZZ_IRQ, 0, fuzz_isr, NULL, 0);
+    irq_enable(CONFIG_ARCH_POSIX_FUZZ_IRQ);
+
+    while (true)
+    {
+        k_sem_take(&fuzz_sem, K_FOREVER);
+
+        if (posix_fuzz_sz < 1)
+        {
+            continue;
+        }
+        if (posix_fuzz_buf[0] & BIT(0))
+        {
+            fuzz_sentences(posix_fuzz_buf + 1, posix_fuzz_sz - 1);
+        }
+        else
+        {
+            fuzz_stream(posix_fuzz_buf + 1, posix_fuzz_sz - 1, ((posix_fuzz_buf[0] >> 1) & 0x3F) + 1);
+        }
+    }
+}
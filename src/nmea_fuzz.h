@@ -0,0 +1,8 @@
+#ifndef _NMEA_FUZZ_H_
+#define _NMEA_FUZZ_H_
+
+// Feed every libFuzzer input through the framer and parsers; never returns
+// (CONFIG_LC29H_NMEA_FUZZ)
+void nmea_fuzz_run(void);
+
+#endif
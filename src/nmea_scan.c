@@ -0,0 +1,278 @@
+#include <stddef.h>
+#include "nmea_scan.h"
+
+#define SCAN_MAX_DIGITS 9   // Largest mantissa that always fits an int32
+
+static const uint32_t pow10_u32[] =
+{
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+// Every power up to 1e10 is exact in a float
+static const float pow10_f32[] =
+{
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static inline bool is_digit(char c)
+{
+    return (uint8_t)(c - '0') <= 9;
+}
+
+bool nmea_scan_uint(const char *s, uint8_t len, uint32_t *out)
+{
+    uint32_t value = 0;
+
+    if ((len == 0) || (len > SCAN_MAX_DIGITS))
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        if (!is_digit(s[i]))
+        {
+            return false;
+        }
+        value = value * 10 + (s[i] - '0');
+    }
+
+    *out = value;
+    return true;
+}
+
+bool nmea_scan_hex(const char *s, uint8_t len, uint32_t *out)
+{
+    uint32_t value = 0;
+
+    if ((len == 0) || (len > 8))
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        char c = s[i];
+
+        if (is_digit(c))
+        {
+            value = (value << 4) | (c - '0');
+        }
+        else if ((c >= 'A') && (c <= 'F'))
+        {
+            value = (value << 4) | (c - 'A' + 10);
+        }
+        else if ((c >= 'a') && (c <= 'f'))
+        {
+            value = (value << 4) | (c - 'a' + 10);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    *out = value;
+    return true;
+}
+
+bool nmea_scan_decimal(const char *s, uint8_t len, int32_t *mantissa, uint8_t *decimals)
+{
+    uint32_t value = 0;
+    uint8_t digits = 0;
+    uint8_t fraction = 0;
+    bool negative = false;
+    bool point = false;
+    uint8_t i = 0;
+
+    if ((len > 0) && ((s[0] == '-') || (s[0] == '+')))
+    {
+        negative = (s[0] == '-');
+        i++;
+    }
+
+    for (; i < len; i++)
+    {
+        if ((s[i] == '.') && !point)
+        {
+            point = true;
+            continue;
+        }
+        if (!is_digit(s[i]))
+        {
+            return false;
+        }
+        digits++;
+
+        // Another digit could leave the int32 range
+        if (value > (pow10_u32[SCAN_MAX_DIGITS - 1] - 1))
+        {
+            if (!point)
+            {
+                return false;  // Integer part too large
+            }
+            continue;          // Drop fraction digits beyond the precision
+        }
+        value = value * 10 + (s[i] - '0');
+        fraction += point;
+    }
+
+    if (digits == 0)
+    {
+        return false;
+    }
+
+    *mantissa = negative ? -(int32_t)value : (int32_t)value;
+    *decimals = fraction;
+    return true;
+}
+
+bool nmea_scan_fixed(const char *s, uint8_t len, uint8_t scale, int32_t *out)
+{
+    int32_t mantissa;
+    uint8_t decimals;
+
+    if (!nmea_scan_decimal(s, len, &mantissa, &decimals) || (scale > SCAN_MAX_DIGITS))
+    {
+        return false;
+    }
+
+    if (decimals <= scale)
+    {
+        int64_t value = (int64_t)mantissa * pow10_u32[scale - decimals];
+        if ((value > INT32_MAX) || (value < -INT32_MAX))
+        {
+            return false;
+        }
+        *out = (int32_t)value;
+        return true;
+    }
+
+    uint32_t div = pow10_u32[decimals - scale];
+    uint32_t mag = (mantissa < 0) ? -(uint32_t)mantissa : (uint32_t)mantissa;
+    mag = (mag + div / 2) / div;
+    *out = (mantissa < 0) ? -(int32_t)mag : (int32_t)mag;
+    return true;
+}
+
+bool nmea_scan_float(const char *s, uint8_t len, float *out)
+{
+    int32_t mantissa;
+    uint8_t decimals;
+
+    if (!nmea_scan_decimal(s, len, &mantissa, &decimals))
+    {
+        return false;
+    }
+
+    if ((mantissa < (1 << 24)) && (mantissa > -(1 << 24)))
+    {
+        // Both operands are exact floats, so the correctly rounded quotient
+        // equals rounding strtod's double result to float
+        *out = (float)mantissa / pow10_f32[decimals];
+    }
+    else
+    {
+        *out = (float)((double)mantissa / (double)pow10_u32[decimals]);
+    }
+    return true;
+}
+
+bool nmea_scan_coord(const char *s, uint8_t len, int32_t *deg_e7)
+{
+    uint32_t whole = 0;
+    uint32_t frac = 0;   // Fraction of a minute in 1e-9 units
+    uint8_t i = 0;
+    uint8_t frac_digits = 0;
+
+    for (; (i < len) && (s[i] != '.'); i++)
+    {
+        if (!is_digit(s[i]) || (i == 5))
+        {
+            return false;
+        }
+        whole = whole * 10 + (s[i] - '0');
+    }
+
+    if (i < 3)
+    {
+        return false;  // Need at least DMM
+    }
+
+    for (i++; i < len; i++)
+    {
+        if (!is_digit(s[i]))
+        {
+            return false;
+        }
+        if (frac_digits < 9)
+        {
+            frac = frac * 10 + (s[i] - '0');
+            frac_digits++;
+        }
+    }
+    frac *= pow10_u32[9 - frac_digits];
+
+    uint32_t degrees = whole / 100;
+    uint32_t minutes = whole % 100;
+
+    if ((minutes >= 60) || (degrees > 180))
+    {
+        return false;
+    }
+
+    // minutes * 1e7 / 60 split so every term stays within 32 bits:
+    // (minutes * 1e9 + frac) / 6000 = minutes * 166666 + (minutes * 4000 + frac) / 6000
+    *deg_e7 = (int32_t)(degrees * 10000000u + minutes * 166666u +
+                        (minutes * 4000u + frac + 3000u) / 6000u);
+    return true;
+}
+
+bool nmea_scan_time(const char *s, uint8_t len, uint32_t *ms)
+{
+    if (len < 6)
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        if (!is_digit(s[i]))
+        {
+            return false;
+        }
+    }
+
+    uint32_t hours   = (s[0] - '0') * 10 + (s[1] - '0');
+    uint32_t minutes = (s[2] - '0') * 10 + (s[3] - '0');
+    uint32_t seconds = (s[4] - '0') * 10 + (s[5] - '0');
+    uint32_t millis = 0;
+
+    if (len > 6)
+    {
+        if (s[6] != '.')
+        {
+            return false;
+        }
+
+        // Up to three fraction digits, scaled to milliseconds
+        uint32_t scale = 100;
+        for (uint8_t i = 7; i < len; i++)
+        {
+            if (!is_digit(s[i]))
+            {
+                return false;
+            }
+            millis += (s[i] - '0') * scale;
+            scale /= 10;
+        }
+    }
+
+    if ((hours >= 24) || (minutes >= 60) || (seconds >= 60))
+    {
+        return false;
+    }
+
+    *ms = ((hours * 60 + minutes) * 60 + seconds) * 1000 + millis;
+    return true;
+}
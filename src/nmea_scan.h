@@ -0,0 +1,32 @@
+#ifndef _NMEA_SCAN_H_
+#define _NMEA_SCAN_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/* Allocation-free scanners for NMEA numeric fields. They read exactly len
+ * bytes, need no NUL terminator and do not depend on locale or errno.
+ * On an empty or malformed field they return false and leave *out alone. */
+
+// Unsigned integer, e.g. "12"
+bool nmea_scan_uint(const char *s, uint8_t len, uint32_t *out);
+
+// Signed decimal as mantissa and number of fraction digits, "-12.345" -> -12345, 3
+bool nmea_scan_decimal(const char *s, uint8_t len, int32_t *mantissa, uint8_t *decimals);
+
+// Hexadecimal digits, either case, e.g. the checksum "5A"
+bool nmea_scan_hex(const char *s, uint8_t len, uint32_t *out);
+
+// Signed decimal in units of 10^-scale, rounded half away from zero
+bool nmea_scan_fixed(const char *s, uint8_t len, uint8_t scale, int32_t *out);
+
+// Signed decimal as float, same bits as (float)atof() on the field
+bool nmea_scan_float(const char *s, uint8_t len, float *out);
+
+// DDMM.MMMMMMM / DDDMM.MMMMMMM to 1e-7 degrees, rounded to nearest
+bool nmea_scan_coord(const char *s, uint8_t len, int32_t *deg_e7);
+
+// hhmmss[.sss] to milliseconds since midnight
+bool nmea_scan_time(const char *s, uint8_t len, uint32_t *ms);
+
+#endif
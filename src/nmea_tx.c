@@ -0,0 +1,293 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+#include "nmea.h"
+#include "nmea_framer.h"
+#include "nmea_tx.h"
+
+LOG_MODULE_REGISTER(nmea_tx, CONFIG_LOG_DEFAULT_LEVEL);
+
+/* The queue carries buffer descriptors in submission order; a chain of
+ * them goes out as one. Sentences wait in slab buffers that carry their
+ * own descriptor; other buffers belong to the caller until done. One
+ * buffer is on the line at a time. */
+struct tx_sentence 
+{
+    struct nmea_tx_buf tx;
+    char buf[NMEA_SENTENCE_MAX_LEN];
+};
+
+#ifdef CONFIG_LC29H_RTCM
+// RTCM3 frames in flight take queue slots of their own
+#define TX_QUEUE_LEN (CONFIG_LC29H_TX_QUEUE_DEPTH + CONFIG_LC29H_RTCM_FRAMES)
+#else
+#define TX_QUEUE_LEN CONFIG_LC29H_TX_QUEUE_DEPTH
+#endif
+
+K_MEM_SLAB_DEFINE_STATIC(tx_slab, sizeof(struct tx_sentence), CONFIG_LC29H_TX_QUEUE_DEPTH, 4);
+K_MSGQ_DEFINE(tx_queue, sizeof(struct nmea_tx_buf *), TX_QUEUE_LEN, 4);
+static K_SEM_DEFINE(tx_idle, 0, 1);
+
+static const struct device *tx_dev;
+static struct nmea_tx_buf *tx_current;
+static atomic_t tx_busy;
+#ifdef CONFIG_LC29H_RX_IRQ
+static uint16_t tx_pos;     // Bytes of tx_current already in the FIFO
+#endif
+
+static void tx_kick(void);
+static void tx_start(struct nmea_tx_buf *next);
+
+static void tx_sentence_done(struct nmea_tx_buf *buf, int result)
+{
+    ARG_UNUSED(result);
+    k_mem_slab_free(&tx_slab, (void *)CONTAINER_OF(buf, struct tx_sentence, tx));
+}
+
+/* Current buffer is out (or failed); hand it back and start the rest of
+ * its chain, or the next queued one. A failure drops the whole chain. */
+static void tx_complete(int result)
+{
+    struct nmea_tx_buf *done = tx_current;
+    struct nmea_tx_buf *next = done->next;
+
+    tx_current = NULL;
+    if (done->done != NULL) 
+    {
+        done->done(done, result);
+    }
+    while ((result != 0) && (next != NULL)) 
+    {
+        done = next;
+        next = done->next;
+        if (done->done != NULL) 
+        {
+            done->done(done, -ECANCELED);
+        }
+    }
+
+    if (next != NULL) 
+    {
+        tx_start(next);
+        return;
+    }
+    atomic_clear(&tx_busy);
+    tx_kick();
+}
+
+static void tx_start(struct nmea_tx_buf *next)
+{
+#ifdef CONFIG_LC29H_RX_IRQ
+    // The interrupt may look at tx_current at any time; position first
+    tx_pos = 0;
+#endif
+    tx_current = next;
+#ifdef CONFIG_LC29H_RX_ASYNC
+    int ret = uart_tx(tx_dev, tx_current->data, tx_current->len, SYS_FOREVER_US);
+
+    if (ret != 0) 
+    {
+        LOG_ERR("uart_tx failed (%d)", ret);
+        tx_complete(ret);
+    }
+#else
+    uart_irq_tx_enable(tx_dev);
+#endif
+}
+
+/* Start the next buffer unless one is on the line. Runs from senders
+ * and from the completion interrupt; the busy flag picks one of them. */
+static void tx_kick(void)
+{
+    struct nmea_tx_buf *next;
+
+    while (atomic_cas(&tx_busy, 0, 1)) 
+    {
+        if (k_msgq_get(&tx_queue, &next, K_NO_WAIT) == 0) 
+        {
+            tx_start(next);
+            return;
+        }
+        atomic_clear(&tx_busy);
+
+        // A buffer queued after the get and before the clear is ours too
+        if (k_msgq_num_used_get(&tx_queue) == 0) 
+        {
+            k_sem_give(&tx_idle);
+            return;
+        }
+    }
+}
+
+#ifdef CONFIG_LC29H_RX_ASYNC
+void nmea_tx_async_event(const struct uart_event *evt)
+{
+    switch (evt->type) 
+    {
+        case UART_TX_DONE:
+            tx_complete(0);
+        break;
+        case UART_TX_ABORTED:
+            LOG_WRN("TX aborted after %u bytes", (uint32_t)evt->data.tx.len);
+            tx_complete(-ECANCELED);
+        break;
+        default:
+        break;
+    }
+}
+#else
+void nmea_tx_isr(const struct device *dev)
+{
+    if (tx_current == NULL) 
+    {
+        uart_irq_tx_disable(dev);
+        return;
+    }
+
+    tx_pos += uart_fifo_fill(dev, &tx_current->data[tx_pos], tx_current->len - tx_pos);
+    if (tx_pos == tx_current->len) 
+    {
+        tx_complete(0);
+        if (tx_current == NULL) 
+        {
+            uart_irq_tx_disable(dev);
+        }
+    }
+}
+#endif
+
+void nmea_tx_init(const struct device *dev)
+{
+    tx_dev = dev;
+}
+
+/* Queue "$<body>*hh\r\n". The body is the address and fields, with or
+ * without the leading '$'; the checksum and terminator are added here. */
+int send_nmea_message(const char *body)
+{
+    struct tx_sentence *sentence;
+    struct nmea_tx_buf *tx;
+    uint8_t checksum = 0;
+    size_t len;
+
+    if (tx_dev == NULL) 
+    {
+        return -ENODEV;
+    }
+
+    if (*body == '$') 
+    {
+        body++;
+    }
+    len = strlen(body);
+    if ((len == 0) || (strpbrk(body, "$*\r\n") != NULL)) 
+    {
+        return -EINVAL;
+    }
+    if (len + sizeof("$*hh\r\n") - 1 > NMEA_SENTENCE_MAX_LEN) 
+    {
+        return -EMSGSIZE;
+    }
+
+    if (k_mem_slab_alloc(&tx_slab, (void **)&sentence, K_NO_WAIT) != 0) 
+    {
+        LOG_WRN("TX queue full, dropped %s", body);
+        return -ENOBUFS;
+    }
+
+    for (size_t i = 0; i < len; i++) 
+    {
+        checksum ^= (uint8_t)body[i];
+    }
+    sentence->buf[0] = '$';
+    memcpy(&sentence->buf[1], body, len);
+    snprintk(&sentence->buf[len + 1], sizeof(sentence->buf) - len - 1, "*%02X\r\n", checksum);
+    sentence->tx.data = (const uint8_t *)sentence->buf;
+    sentence->tx.len = len + sizeof("$*hh\r\n") - 1;
+    sentence->tx.next = NULL;
+    sentence->tx.done = tx_sentence_done;
+    tx = &sentence->tx;
+
+    // Cannot fail: every slab buffer has a queue slot
+    k_msgq_put(&tx_queue, &tx, K_NO_WAIT);
+    tx_kick();
+    return 0;
+}
+
+int nmea_tx_submit(struct nmea_tx_buf *buf)
+{
+    if (tx_dev == NULL) 
+    {
+        return -ENODEV;
+    }
+    if (k_msgq_put(&tx_queue, &buf, K_NO_WAIT) != 0) 
+    {
+        return -ENOBUFS;
+    }
+    tx_kick();
+    return 0;
+}
+
+int nmea_tx_flush(k_timeout_t timeout)
+{
+    k_sem_reset(&tx_idle);
+    if ((atomic_get(&tx_busy) == 0) && (k_msgq_num_used_get(&tx_queue) == 0)) 
+    {
+        return 0;
+    }
+    return k_sem_take(&tx_idle, timeout);
+}
+
+int nmea_tx_set_baud(uint32_t baud)
+{
+#ifdef CONFIG_UART_USE_RUNTIME_CONFIGURE
+    struct uart_config cfg;
+    int ret;
+
+    if (tx_dev == NULL) 
+    {
+        return -ENODEV;
+    }
+
+    // The last command still goes out at the old rate
+    ret = nmea_tx_flush(K_MSEC(100));
+    if (ret != 0) 
+    {
+        return ret;
+    }
+
+    ret = uart_config_get(tx_dev, &cfg);
+    if (ret != 0) 
+    {
+        return ret;
+    }
+    cfg.baudrate = baud;
+    return uart_configure(tx_dev, &cfg);
+#else
+    ARG_UNUSED(baud);
+    return -ENOTSUP;
+#endif
+}
+
+int nmea_tx_get_baud(uint32_t *baud)
+{
+#ifdef CONFIG_UART_USE_RUNTIME_CONFIGURE
+    struct uart_config cfg;
+    int ret;
+
+    if (tx_dev == NULL) 
+    {
+        return -ENODEV;
+    }
+
+    ret = uart_config_get(tx_dev, &cfg);
+    if (ret == 0) 
+    {
+        *baud = cfg.baudrate;
+    }
+    return ret;
+#else
+    ARG_UNUSED(baud);
+    return -ENOTSUP;
+#endif
+}
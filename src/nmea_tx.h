@@ -0,0 +1,54 @@
+#ifndef _NMEA_TX_H_
+#define _NMEA_TX_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+
+/* Command transmit queue. send_nmea_message() formats a sentence into a
+ * slab buffer and queues it; nmea_tx_submit() queues a caller's buffer as
+ * it is. The UART sends queued buffers back to back (uart_tx DMA with
+ * CONFIG_LC29H_RX_ASYNC, the TX FIFO interrupt with CONFIG_LC29H_RX_IRQ),
+ * so the caller never waits for the line. */
+
+struct nmea_tx_buf;
+
+// From the TX completion interrupt: 0 once sent, else the buffer was dropped
+typedef void (*nmea_tx_done_t)(struct nmea_tx_buf *buf, int result);
+
+struct nmea_tx_buf
+{
+    const uint8_t *data;
+    uint16_t len;
+    struct nmea_tx_buf *next;   // Sent right after this one, nothing in between
+    nmea_tx_done_t done;        // May be NULL
+    void *user_data;
+};
+
+// Start transmitting on dev; sentences sent before this fail with -ENODEV
+void nmea_tx_init(const struct device *dev);
+
+/* Queue buf and the buffers chained to it, without copying. The bytes
+ * must stay untouched until each buffer's done callback; -ENOBUFS if the
+ * queue is full. */
+int nmea_tx_submit(struct nmea_tx_buf *buf);
+
+// Wait until every queued sentence has left the UART
+int nmea_tx_flush(k_timeout_t timeout);
+
+/* Drain the queue, then switch the UART to baud. Needs
+ * CONFIG_UART_USE_RUNTIME_CONFIGURE, else -ENOTSUP. */
+int nmea_tx_set_baud(uint32_t baud);
+
+// Current UART baud rate; -ENOTSUP as above
+int nmea_tx_get_baud(uint32_t *baud);
+
+#ifdef CONFIG_LC29H_RX_ASYNC
+// UART_TX_DONE / UART_TX_ABORTED from the driver callback
+void nmea_tx_async_event(const struct uart_event *evt);
+#else
+// TX ready interrupt
+void nmea_tx_isr(const struct device *dev);
+#endif
+
+#endif
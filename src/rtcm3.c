@@ -0,0 +1,328 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "nmea_tx.h"
+#include "rtcm3.h"
+
+LOG_MODULE_REGISTER(rtcm3, CONFIG_LOG_DEFAULT_LEVEL);
+
+// CRC-24Q (polynomial 0x1864CFB), a nibble at a time
+static const uint32_t crc24q_nibble[16] =
+{
+    0x000000, 0x864CFB, 0x8AD50D, 0x0C99F6, 0x93E6E1, 0x15AA1A, 0x1933EC, 0x9F7F17,
+    0xA18139, 0x27CDC2, 0x2B5434, 0xAD18CF, 0x3267D8, 0xB42B23, 0xB8B2D5, 0x3EFE2E,
+};
+
+uint32_t rtcm3_crc24q(uint32_t crc, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        crc = (crc << 4) ^ crc24q_nibble[((crc >> 20) ^ (data[i] >> 4)) & 0xF];
+        crc = (crc << 4) ^ crc24q_nibble[((crc >> 20) ^ data[i]) & 0xF];
+    }
+    return crc & 0xFFFFFF;
+}
+
+#ifdef CONFIG_LC29H_RTCM
+#define RTCM_SIZE CONFIG_LC29H_RTCM_BUF_SIZE
+#define RTCM_MASK (RTCM_SIZE - 1)
+
+// Positions run freely and wrap at 2^32 with the buffer index
+BUILD_ASSERT(IS_POWER_OF_TWO(RTCM_SIZE), "LC29H_RTCM_BUF_SIZE must be a power of two");
+BUILD_ASSERT(RTCM_SIZE >= RTCM3_FRAME_MAX, "LC29H_RTCM_BUF_SIZE must hold a whole frame");
+
+/* A frame on its way to the UART. The bytes stay in the buffer; a frame
+ * across its end goes out as two chained pieces. */
+struct rtcm_tx
+{
+    struct nmea_tx_buf seg[2];
+    uint32_t end;            // Position freed once sent
+};
+
+K_MEM_SLAB_DEFINE_STATIC(rtcm_tx_slab, sizeof(struct rtcm_tx), CONFIG_LC29H_RTCM_FRAMES, 4);
+
+/* tail <= scan <= head. [tail, scan) is being sent or was skipped,
+ * [scan, head) is not checked yet. The writer moves head, the scanner
+ * scan, the TX completion interrupt tail. */
+static uint8_t rtcm_buf[RTCM_SIZE];
+static uint32_t rtcm_head;
+static uint32_t rtcm_scan;
+static uint32_t rtcm_tail;
+static uint32_t rtcm_inflight;
+static bool rtcm_stalled;    // Complete frames wait for a free rtcm_tx
+
+static struct k_spinlock rtcm_spin;
+static K_MUTEX_DEFINE(rtcm_lock);
+static K_SEM_DEFINE(rtcm_space, 0, 1);
+
+static struct rtcm3_stats rtcm_stats;
+
+static void rtcm_scan_work_fn(struct k_work *work);
+static K_WORK_DEFINE(rtcm_scan_work, rtcm_scan_work_fn);
+
+static inline uint8_t rtcm_byte(uint32_t pos)
+{
+    return rtcm_buf[pos & RTCM_MASK];
+}
+
+// CRC-24Q of len bytes from pos, across the end of the buffer if need be
+static uint32_t rtcm_crc(uint32_t pos, uint32_t len)
+{
+    uint32_t index = pos & RTCM_MASK;
+    uint32_t first = MIN(len, RTCM_SIZE - index);
+    uint32_t crc = rtcm3_crc24q(0, &rtcm_buf[index], first);
+
+    return rtcm3_crc24q(crc, rtcm_buf, len - first);
+}
+
+// TX completion interrupt, once per frame; frames complete in order
+static void rtcm_tx_done(struct nmea_tx_buf *buf, int result)
+{
+    struct rtcm_tx *tx = buf->user_data;
+    k_spinlock_key_t key = k_spin_lock(&rtcm_spin);
+    bool stalled = rtcm_stalled;
+
+    if (result != 0)
+    {
+        rtcm_stats.tx_errors++;
+    }
+    // With nothing else in flight, bytes skipped after this frame go too
+    rtcm_tail = (--rtcm_inflight == 0) ? rtcm_scan : tx->end;
+    rtcm_stalled = false;
+    k_spin_unlock(&rtcm_spin, key);
+
+    k_mem_slab_free(&rtcm_tx_slab, (void *)tx);
+    k_sem_give(&rtcm_space);
+    if (stalled)
+    {
+        k_work_submit(&rtcm_scan_work);
+    }
+}
+
+static void rtcm_skip(uint32_t len)
+{
+    k_spinlock_key_t key = k_spin_lock(&rtcm_spin);
+
+    rtcm_scan += len;
+    rtcm_stats.skipped += len;
+    if (rtcm_inflight == 0)
+    {
+        rtcm_tail = rtcm_scan;
+    }
+    k_spin_unlock(&rtcm_spin, key);
+    k_sem_give(&rtcm_space);
+}
+
+static void rtcm_count(uint16_t type, uint32_t len)
+{
+    rtcm_stats.frames++;
+    rtcm_stats.bytes += len;
+
+    for (uint8_t i = 0; i < rtcm_stats.type_count; i++)
+    {
+        if (rtcm_stats.types[i].type == type)
+        {
+            rtcm_stats.types[i].frames++;
+            rtcm_stats.types[i].bytes += len;
+            return;
+        }
+    }
+    if (rtcm_stats.type_count == CONFIG_LC29H_RTCM_TYPES)
+    {
+        rtcm_stats.other_frames++;
+        return;
+    }
+    rtcm_stats.types[rtcm_stats.type_count++] = (struct rtcm3_type_stats){ type, 1, len };
+}
+
+// Queue the checked frame of len bytes at scan; false if every rtcm_tx is in flight
+static bool rtcm_queue(uint32_t len, uint16_t type)
+{
+    struct rtcm_tx *tx;
+    uint32_t index = rtcm_scan & RTCM_MASK;
+    uint32_t first = MIN(len, RTCM_SIZE - index);
+    k_spinlock_key_t key;
+    int ret;
+
+    if (k_mem_slab_alloc(&rtcm_tx_slab, (void **)&tx, K_NO_WAIT) != 0)
+    {
+        // Flag first: a frame completing after this restarts the scan
+        key = k_spin_lock(&rtcm_spin);
+        rtcm_stalled = true;
+        k_spin_unlock(&rtcm_spin, key);
+        if (k_mem_slab_alloc(&rtcm_tx_slab, (void **)&tx, K_NO_WAIT) != 0)
+        {
+            return false;
+        }
+    }
+
+    tx->seg[0] = (struct nmea_tx_buf){ &rtcm_buf[index], first, NULL, rtcm_tx_done, tx };
+    if (first < len)
+    {
+        tx->seg[0].next = &tx->seg[1];
+        tx->seg[0].done = NULL;
+        tx->seg[1] = (struct nmea_tx_buf){ rtcm_buf, len - first, NULL, rtcm_tx_done, tx };
+    }
+    tx->end = rtcm_scan + len;
+
+    key = k_spin_lock(&rtcm_spin);
+    rtcm_inflight++;
+    rtcm_scan += len;
+    k_spin_unlock(&rtcm_spin, key);
+    rtcm_count(type, len);
+
+    ret = nmea_tx_submit(&tx->seg[0]);
+    if (ret != 0)
+    {
+        LOG_WRN("RTCM %u dropped (%d)", type, ret);
+        rtcm_tx_done(&tx->seg[0], ret);
+    }
+    return true;
+}
+
+/* Check what arrived since the last call: queue each valid frame, skip
+ * a byte and resynchronise on anything else. Holds rtcm_lock. */
+static void rtcm_scan_frames(void)
+{
+    uint32_t avail;
+
+    while ((avail = rtcm_head - rtcm_scan) > 0)
+    {
+        uint32_t index = rtcm_scan & RTCM_MASK;
+        uint32_t len;
+        uint16_t type;
+
+        if (rtcm_buf[index] != RTCM3_PREAMBLE)
+        {
+            uint32_t run = MIN(avail, RTCM_SIZE - index);
+            const uint8_t *preamble = memchr(&rtcm_buf[index], RTCM3_PREAMBLE, run);
+
+            rtcm_skip((preamble != NULL) ? (uint32_t)(preamble - &rtcm_buf[index]) : run);
+            continue;
+        }
+        if (avail < RTCM3_HEADER_LEN)
+        {
+            return;
+        }
+        if (rtcm_byte(rtcm_scan + 1) & 0xFC)
+        {
+            // Reserved bits set: not a frame start
+            rtcm_skip(1);
+            continue;
+        }
+
+        len = ((rtcm_byte(rtcm_scan + 1) & 0x03) << 8) | rtcm_byte(rtcm_scan + 2);
+        len += RTCM3_HEADER_LEN + RTCM3_CRC_LEN;
+        if (avail < len)
+        {
+            return;
+        }
+        if (rtcm_crc(rtcm_scan, len - RTCM3_CRC_LEN) !=
+            (((uint32_t)rtcm_byte(rtcm_scan + len - 3) << 16) |
+             (rtcm_byte(rtcm_scan + len - 2) << 8) | rtcm_byte(rtcm_scan + len - 1)))
+        {
+            rtcm_stats.crc_errors++;
+            rtcm_skip(1);
+            continue;
+        }
+
+        type = (len > RTCM3_HEADER_LEN + RTCM3_CRC_LEN + 1)
+               ? (rtcm_byte(rtcm_scan + 3) << 4) | (rtcm_byte(rtcm_scan + 4) >> 4) : 0;
+        if (!rtcm_queue(len, type))
+        {
+            return;
+        }
+    }
+}
+
+static void rtcm_scan_work_fn(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    k_mutex_lock(&rtcm_lock, K_FOREVER);
+    rtcm_scan_frames();
+    k_mutex_unlock(&rtcm_lock);
+}
+
+static uint32_t rtcm_used(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&rtcm_spin);
+    uint32_t used = rtcm_head - rtcm_tail;
+
+    k_spin_unlock(&rtcm_spin, key);
+    return used;
+}
+
+int rtcm3_claim(uint8_t **data, k_timeout_t timeout)
+{
+    uint32_t used = rtcm_used();
+
+    if (used == RTCM_SIZE)
+    {
+        // The UART drains the buffer; never drop what the network delivered
+        rtcm_stats.waits++;
+        do
+        {
+            if (k_sem_take(&rtcm_space, timeout) != 0)
+            {
+                return -EAGAIN;
+            }
+        } while ((used = rtcm_used()) == RTCM_SIZE);
+    }
+
+    *data = &rtcm_buf[rtcm_head & RTCM_MASK];
+    return MIN(RTCM_SIZE - used, RTCM_SIZE - (rtcm_head & RTCM_MASK));
+}
+
+void rtcm3_commit(size_t len)
+{
+    k_spinlock_key_t key;
+
+    k_mutex_lock(&rtcm_lock, K_FOREVER);
+    key = k_spin_lock(&rtcm_spin);
+    rtcm_head += len;
+    rtcm_stats.peak = MAX(rtcm_stats.peak, rtcm_head - rtcm_tail);
+    k_spin_unlock(&rtcm_spin, key);
+
+    rtcm_scan_frames();
+    k_mutex_unlock(&rtcm_lock);
+}
+
+int rtcm3_write(const uint8_t *data, size_t len, k_timeout_t timeout)
+{
+    size_t written = 0;
+
+    while (written < len)
+    {
+        uint8_t *room;
+        int size = rtcm3_claim(&room, timeout);
+
+        if (size < 0)
+        {
+            return (written > 0) ? (int)written : size;
+        }
+        size = MIN((size_t)size, len - written);
+        memcpy(room, &data[written], size);
+        rtcm3_commit(size);
+        written += size;
+    }
+    return written;
+}
+
+void rtcm3_stats_get(struct rtcm3_stats *stats, bool reset)
+{
+    k_spinlock_key_t key;
+
+    // The mutex holds off the scanner, the spinlock the TX completion interrupt
+    k_mutex_lock(&rtcm_lock, K_FOREVER);
+    key = k_spin_lock(&rtcm_spin);
+    *stats = rtcm_stats;
+    if (reset)
+    {
+        memset(&rtcm_stats, 0, sizeof(rtcm_stats));
+        rtcm_stats.since = k_uptime_get();
+    }
+    k_spin_unlock(&rtcm_spin, key);
+    k_mutex_unlock(&rtcm_lock);
+}
+#endif
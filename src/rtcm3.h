@@ -0,0 +1,69 @@
+#ifndef _RTCM3_H_
+#define _RTCM3_H_
+
+#include <zephyr/kernel.h>
+#include <inttypes.h>
+#include <stdbool.h>
+
+/* RTCM3 transport frame:
+ *
+ *   0xD3 | 6 reserved bits, 10 bit length | payload | CRC-24Q
+ *
+ * The CRC covers the header and payload; the message number is the
+ * first 12 bits of the payload (1077 GPS MSM7, 1087 GLONASS, ...). */
+#define RTCM3_PREAMBLE    0xD3
+#define RTCM3_HEADER_LEN  3
+#define RTCM3_CRC_LEN     3
+#define RTCM3_PAYLOAD_MAX 1023
+#define RTCM3_FRAME_MAX   (RTCM3_HEADER_LEN + RTCM3_PAYLOAD_MAX + RTCM3_CRC_LEN)
+
+// CRC-24Q of len more bytes; start with crc 0 (LC29H_RTCM or LC29H_DEMUX)
+uint32_t rtcm3_crc24q(uint32_t crc, const uint8_t *data, size_t len);
+
+#ifdef CONFIG_LC29H_RTCM
+struct rtcm3_type_stats
+{
+    uint16_t type;
+    uint32_t frames;
+    uint32_t bytes;
+};
+
+/* Correction forwarding statistics (see CONFIG_LC29H_RTCM) */
+struct rtcm3_stats
+{
+    int64_t since;           // Uptime (ms) of the last reset
+    uint32_t frames;         // Frames queued for the receiver
+    uint32_t bytes;          // Bytes of those frames
+    uint32_t crc_errors;     // Frames failing the CRC-24Q
+    uint32_t skipped;        // Bytes outside any valid frame
+    uint32_t tx_errors;      // Frames the UART did not send
+    uint32_t waits;          // Writes that waited for room
+    uint32_t peak;           // Buffer high-water mark
+    uint8_t type_count;
+    struct rtcm3_type_stats types[CONFIG_LC29H_RTCM_TYPES];  // In order first seen
+    uint32_t other_frames;   // Types beyond those
+};
+
+/* The stream goes into a buffer the UART sends from. A writer receives
+ * straight into it:
+ *
+ *   len = rtcm3_claim(&data, K_FOREVER);
+ *   len = recv(sock, data, len, 0);
+ *   rtcm3_commit(len);
+ *
+ * Complete frames are checked and queued in place at each commit. One
+ * writer at a time. */
+
+// Contiguous room for the next bytes, waiting up to timeout for the UART to free some (-EAGAIN)
+int rtcm3_claim(uint8_t **data, k_timeout_t timeout);
+
+// len bytes were written at the claimed position
+void rtcm3_commit(size_t len);
+
+// Copy len bytes in (a replayed file); returns the bytes taken before timeout
+int rtcm3_write(const uint8_t *data, size_t len, k_timeout_t timeout);
+
+void rtcm3_stats_get(struct rtcm3_stats *stats, bool reset);
+#endif
+
+#endif
@@ -4,6 +4,32 @@
 #include "shellnmea.h"
 #include "nmea.h"
 #include "gps.h"
+#include "gnss_stats.h"
+#include "gnss_governor.h"
+#ifdef CONFIG_LC29H_HISTORY
+#include "gnss_history.h"
+#endif
+#ifdef CONFIG_LC29H_TRACK
+#include "gnss_track.h"
+#endif
+#ifdef CONFIG_LC29H_CMD
+#include "nmea_cmd.h"
+#endif
+#ifdef CONFIG_LC29H_CONFIG
+#include "lc29h_config.h"
+#endif
+#ifdef CONFIG_LC29H_BAUD
+#include "lc29h_baud.h"
+#endif
+#ifdef CONFIG_LC29H_RTCM
+#include "rtcm3.h"
+#endif
+#ifdef CONFIG_LC29H_DEMUX
+#include "gnss_demux.h"
+#endif
+#ifdef CONFIG_LC29H_NMEA_GSV
+#include "gnss_sats.h"
+#endif
 
 LOG_MODULE_REGISTER(shellnmea, LOG_LEVEL_INF);
 
@@ -13,6 +39,19 @@ static int cmd_swversion(const struct shell *shell, size_t argc, char **argv)
     ARG_UNUSED(argc);
     ARG_UNUSED(argv);
     
+#ifdef CONFIG_LC29H_CMD
+    // The parser stores the version before the response completes the command
+    GNSS_Info info;
+    int ret = nmea_cmd_send(LC29H_VERNO_CMD);
+
+    if (ret != 0) 
+    {
+        shell_error(shell, "Version request failed (%d)", ret);
+        return ret;
+    }
+    gnss_get_info(&info);
+    shell_print(shell, "Firmware version: %s", info.firmware_version);
+#else
     if (send_nmea_message(LC29H_VERNO_CMD) != 0) 
 	{
         shell_error(shell, "Failed to send version request");
@@ -20,6 +59,7 @@ static int cmd_swversion(const struct shell *shell, size_t argc, char **argv)
     }
     
     shell_print(shell, "Requested software version from LH29C");
+#endif
     return 0;
 }
 
@@ -27,28 +67,20 @@ static int cmd_show_swversion(const struct shell *shell, size_t argc, char **arg
 {
     ARG_UNUSED(argc);
     ARG_UNUSED(argv);
+    GNSS_Info info;
 
-    if (gnss_data == NULL || strlen(gnss_data->firmware_version) == 0) 
+    gnss_get_info(&info);
+    if (strlen(info.firmware_version) == 0) 
     {
         shell_warn(shell, "Software version not available.");
     }
     else 
     {
-        shell_print(shell, "Firmware version: %s", gnss_data->firmware_version);
+        shell_print(shell, "Firmware version: %s", info.firmware_version);
     }
     return 0;
 }
 
-static uint8_t shell_checksum(const char *sentence)
-{
-    uint8_t checksum = 0;
-    sentence++; 
-    while (*sentence && *sentence != '*') {
-        checksum ^= *sentence++;
-    }
-    return checksum;
-}
-
 /* Shell command handler: Custom NMEA command forwarding */
 static int cmd_send_nmea(const struct shell *shell, size_t argc, char **argv)
 {
@@ -61,26 +93,23 @@ static int cmd_send_nmea(const struct shell *shell, size_t argc, char **argv)
 
     const char *base = argv[1];
 
-    // Validate base sentence
-    if (strlen(base) < 6 || base[0] != '$') 
+    // Validate base sentence: an address of 5 characters at least, '$' optional
+    if (strlen(base) < ((base[0] == '$') ? 6 : 5)) 
     {
         shell_error(shell, "Invalid NMEA command format");
         return -EINVAL;
     }
 
-    uint8_t checksum = shell_checksum(base);
-
-    // Format full sentence with checksum and termination
-    char cmd_buf[128];
-    snprintf(cmd_buf, sizeof(cmd_buf), "%s*%02X\r\n", base, checksum);
+    // Checksum and terminator are added by the TX queue
+    int ret = send_nmea_message(base);
 
-    if (send_nmea_message(cmd_buf) != 0) 
+    if (ret != 0) 
     {
-        shell_error(shell, "Failed to send NMEA command");
-        return -EIO;
+        shell_error(shell, "Failed to queue NMEA command (%d)", ret);
+        return ret;
     }
 
-    shell_print(shell, "Sent to LH29C: %s", cmd_buf);
+    shell_print(shell, "Queued for LH29C: %s", base);
     return 0;
 }
 
@@ -88,25 +117,426 @@ static int cmd_read_nmea(const struct shell *shell, size_t argc, char **argv)
 {
     ARG_UNUSED(argc);
     ARG_UNUSED(argv);
-    if (!UTC_time.valid) 
+    GNSS_Snapshot snapshot;
+
+    // One consistent copy, so position and time belong to the same fix
+    gnss_get_snapshot(&snapshot);
+    const TimeStruct *utc = &snapshot.utc;
+    const GNSS_Data *fix = &snapshot.data;
+    double latitude = fix->latitude / 1e7;
+    double longitude = fix->longitude / 1e7;
+
+    if (!utc->valid) 
     {
         shell_error(shell,"Invalid time\n");
     }
     
-    shell_print(shell,"%-25s: %02u:%02u:%02u.%03u\n", "UTC Time", UTC_time.hours, UTC_time.minutes, UTC_time.seconds, UTC_time.millis);
-    shell_print(shell,"%-25s: %.06lf\n", "The Latitude is", gnss_data->latitude);
-    shell_print(shell,"%-25s: %.06lf\n", "The Longitude is", gnss_data->longitude);
-    shell_print(shell,"%-25s: %.01lf\n", "The Altitude is", (double)gnss_data->altitude);
-    shell_print(shell,"https://www.google.com/maps?q=%.06lf,%.06lf&z=18\n", gnss_data->latitude, gnss_data->longitude);
+    shell_print(shell,"%-25s: %u\n", "Epoch", snapshot.epoch);
+    shell_print(shell,"%-25s: %02u:%02u:%02u.%03u\n", "UTC Time", utc->hours, utc->minutes, utc->seconds, utc->millis);
+    shell_print(shell,"%-25s: %.07lf\n", "The Latitude is", latitude);
+    shell_print(shell,"%-25s: %.07lf\n", "The Longitude is", longitude);
+#ifdef CONFIG_LC29H_NMEA_GGA
+    shell_print(shell,"%-25s: %.01lf\n", "The Altitude is", (double)fix->altitude);
+#endif
+    shell_print(shell,"https://www.google.com/maps?q=%.06lf,%.06lf&z=18\n", latitude, longitude);
     
     return 0;
 }
 
+#ifdef CONFIG_LC29H_RX_PROFILE
+static int cmd_rx_profile(const struct shell *shell, size_t argc, char **argv)
+{
+    struct gnss_rx_profile profile;
+    bool reset = (argc > 1) && (strcmp(argv[1], "reset") == 0);
+
+    gnss_rx_profile_get(&profile, reset);
+
+    shell_print(shell, "%-25s: %u", "ISR entries", profile.isr_entries);
+    shell_print(shell, "%-25s: %u", "Parser wakeups", profile.parser_wakeups);
+    shell_print(shell, "%-25s: %u", "Parser runs", profile.parser_runs);
+    shell_print(shell, "%-25s: %u", "Budget stops", profile.budget_stops);
+    shell_print(shell, "%-25s: %u", "Sentences", profile.sentences);
+
+    if (profile.sentences == 0) 
+    {
+        return 0;
+    }
+
+    // Per sentence figures are what we compare between RX modes
+    shell_print(shell, "%-25s: %u.%02u", "ISR entries/sentence",
+                profile.isr_entries / profile.sentences,
+                (profile.isr_entries % profile.sentences) * 100 / profile.sentences);
+    shell_print(shell, "%-25s: %u ns", "ISR time/sentence",
+                (uint32_t)(k_cyc_to_ns_floor64(profile.isr_cycles) / profile.sentences));
+    shell_print(shell, "%-25s: %u ns", "Parse time/sentence",
+                (uint32_t)(k_cyc_to_ns_floor64(profile.parse_cycles) / profile.sentences));
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_LC29H_STATS
+static const char *const stats_type_names[NMEA_TYPE_COUNT] = 
+{
+    [NMEA_UNKNOWN] = "unhandled", [NMEA_GGA] = "GGA", [NMEA_RMC] = "RMC",
+    [NMEA_VTG] = "VTG", [NMEA_GSA] = "GSA", [NMEA_GSV] = "GSV",
+    [NMEA_GLL] = "GLL", [NMEA_ZDA] = "ZDA", [NMEA_GST] = "GST",
+    [NMEA_GNS] = "GNS", [NMEA_GRS] = "GRS", [NMEA_PQTMVERNO] = "PQTMVERNO",
+};
+
+static int cmd_gnss_stats(const struct shell *shell, size_t argc, char **argv)
+{
+    struct gnss_stats stats;
+    bool reset = (argc > 1) && (strcmp(argv[1], "reset") == 0);
+
+    gnss_stats_get(&stats, reset);
+
+    int64_t elapsed_ms = MAX(k_uptime_get() - stats.since, 1);
+
+    shell_print(shell, "%-25s: %u.%03u s", "Interval",
+                (uint32_t)(elapsed_ms / 1000), (uint32_t)(elapsed_ms % 1000));
+    shell_print(shell, "%-25s: %u (%u B/s)", "Bytes received", stats.bytes,
+                (uint32_t)(stats.bytes * 1000ull / elapsed_ms));
+    shell_print(shell, "%-25s: %u", "Ring overruns (bytes)", stats.overruns);
+    shell_print(shell, "%-25s: %u", "Ring high-water mark", stats.ring_hwm);
+    shell_print(shell, "%-25s: %u", "Overlong sentences", stats.overlong);
+    shell_print(shell, "%-25s: %u", "Malformed sentences", stats.malformed);
+    shell_print(shell, "%-25s: %u", "Checksum errors", stats.checksum_errors);
+
+    for (int type = 0; type < NMEA_TYPE_COUNT; type++) 
+    {
+        if (stats.sentences[type] != 0) 
+        {
+            uint32_t centi_hz = stats.sentences[type] * 100000ull / elapsed_ms;
+
+            shell_print(shell, "%-25s: %u (%u.%02u/s)", stats_type_names[type],
+                        stats.sentences[type], centi_hz / 100, centi_hz % 100);
+        }
+    }
+
+    if (stats.latency_count != 0) 
+    {
+        shell_print(shell, "%-25s: %u us avg, %u us max", "Latency ($ to parsed)",
+                    (uint32_t)(k_cyc_to_ns_floor64(stats.latency_sum / stats.latency_count) / 1000),
+                    (uint32_t)(k_cyc_to_ns_floor64(stats.latency_max) / 1000));
+    }
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_LC29H_HISTORY
+static int cmd_gnss_history(const struct shell *shell, size_t argc, char **argv)
+{
+    struct gnss_history_iter iter;
+    struct gnss_history_fix fix;
+    uint32_t fixes;
+    uint32_t bytes;
+
+    if ((argc > 1) && (strcmp(argv[1], "clear") == 0)) 
+    {
+        gnss_history_clear();
+        return 0;
+    }
+
+    if ((argc > 1) && (strcmp(argv[1], "dump") == 0)) 
+    {
+        gnss_history_iter_init(&iter);
+        while (gnss_history_iter_next(&iter, &fix)) 
+        {
+            shell_print(shell, "%04u-%02u-%02u %02u:%02u:%02u.%03u %.07lf %.07lf %d.%02u",
+                        fix.year, fix.month, fix.day, fix.time_ms / 3600000,
+                        fix.time_ms / 60000 % 60, fix.time_ms / 1000 % 60, fix.time_ms % 1000,
+                        fix.latitude / 1e7, fix.longitude / 1e7,
+                        fix.altitude / 100, (uint32_t)abs(fix.altitude % 100));
+        }
+    }
+
+    gnss_history_usage(&fixes, &bytes);
+    shell_print(shell, "%-25s: %u", "Fixes stored", fixes);
+    shell_print(shell, "%-25s: %u of %u", "Bytes used", bytes, CONFIG_LC29H_HISTORY_SIZE);
+    if (fixes != 0) 
+    {
+        shell_print(shell, "%-25s: %u.%02u", "Bytes per fix", bytes / fixes,
+                    bytes * 100 / fixes % 100);
+    }
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_LC29H_CMD
+static void cmd_print_response(struct nmea_cmd *cmd, int result, const NMEA_Fields *response)
+{
+    const struct shell *shell = cmd->user_data;
+
+    if (response != NULL) 
+    {
+        // Without the "*hh\r\n"
+        shell_print(shell, "%.*s", response->start[response->count - 1] +
+                    response->len[response->count - 1], response->sentence);
+    }
+}
+
+static int cmd_gnss_cmd(const struct shell *shell, size_t argc, char **argv)
+{
+    struct nmea_cmd cmd;
+    int ret;
+
+    nmea_cmd_init(&cmd, argv[1], cmd_print_response, (void *)shell);
+    cmd.query = (argc > 2) && (strcmp(argv[2], "query") == 0);
+
+    ret = nmea_cmd_submit(&cmd);
+    if (ret == 0) 
+    {
+        ret = nmea_cmd_wait(&cmd, K_FOREVER);
+    }
+    if (ret != 0) 
+    {
+        shell_error(shell, "%s failed (%d)", argv[1], ret);
+    }
+    return ret;
+}
+#endif
+
+#ifdef CONFIG_LC29H_CONFIG
+static int cmd_gnss_config(const struct shell *shell, size_t argc, char **argv)
+{
+    struct lc29h_profile profile;
+    int changes;
+
+    lc29h_profile_default(&profile);
+    changes = lc29h_config_apply(&profile, IS_ENABLED(CONFIG_LC29H_CONFIG_SAVE));
+    if (changes < 0) 
+    {
+        shell_error(shell, "Profile failed (%d)", changes);
+        return changes;
+    }
+    shell_print(shell, "%d settings changed", changes);
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_LC29H_GOVERNOR
+static int cmd_gnss_governor(const struct shell *shell, size_t argc, char **argv)
+{
+    struct gnss_governor_status status;
+
+    gnss_governor_get(&status);
+    shell_print(shell, "%-25s: %u of %u", "Level", status.level, GNSS_GOVERNOR_LEVELS - 1);
+    shell_print(shell, "%-25s: %u", "GSV every Nth fix", status.gsv_rate);
+    shell_print(shell, "%-25s: %u", "GSA every Nth fix", status.gsa_rate);
+    shell_print(shell, "%-25s: %u%%", "Ring peak fill", status.fill_pct);
+    shell_print(shell, "%-25s: %u us", "Parser delay", status.lag_us);
+    shell_print(shell, "%-25s: %u", "Bytes lost", status.lost);
+    shell_print(shell, "%-25s: %u", "Throttle steps", status.steps_down);
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_LC29H_BAUD
+static int cmd_gnss_baud(const struct shell *shell, size_t argc, char **argv)
+{
+    int ret;
+
+    if (argc > 1) 
+    {
+        ret = (strcmp(argv[1], "detect") == 0) ? lc29h_baud_detect()
+                                               : lc29h_baud_set(strtoul(argv[1], NULL, 10));
+        if (ret < 0) 
+        {
+            shell_error(shell, "Failed (%d), link at %u baud", ret, lc29h_baud_get());
+            return ret;
+        }
+    }
+    shell_print(shell, "%-25s: %u", "Baud rate", lc29h_baud_get());
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_LC29H_RTCM
+static int cmd_gnss_rtcm(const struct shell *shell, size_t argc, char **argv)
+{
+    struct rtcm3_stats stats;
+    bool reset = (argc > 1) && (strcmp(argv[1], "reset") == 0);
+
+    rtcm3_stats_get(&stats, reset);
+
+    int64_t elapsed_ms = MAX(k_uptime_get() - stats.since, 1);
+
+    shell_print(shell, "%-25s: %u (%u B/s)", "Frames sent", stats.frames,
+                (uint32_t)(stats.bytes * 1000ull / elapsed_ms));
+    shell_print(shell, "%-25s: %u", "CRC errors", stats.crc_errors);
+    shell_print(shell, "%-25s: %u", "Bytes skipped", stats.skipped);
+    shell_print(shell, "%-25s: %u", "UART errors", stats.tx_errors);
+    shell_print(shell, "%-25s: %u of %u", "Buffer high-water mark", stats.peak,
+                CONFIG_LC29H_RTCM_BUF_SIZE);
+    shell_print(shell, "%-25s: %u", "Writer waits", stats.waits);
+
+    for (uint8_t i = 0; i < stats.type_count; i++) 
+    {
+        shell_print(shell, "RTCM %-20u: %u (%u B)", stats.types[i].type,
+                    stats.types[i].frames, stats.types[i].bytes);
+    }
+    if (stats.other_frames != 0) 
+    {
+        shell_print(shell, "%-25s: %u", "Other types", stats.other_frames);
+    }
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_LC29H_DEMUX
+static int cmd_gnss_demux(const struct shell *shell, size_t argc, char **argv)
+{
+    struct gnss_demux_stats stats;
+    bool reset = (argc > 1) && (strcmp(argv[1], "reset") == 0);
+
+    gnss_demux_stats_get(&stats, reset);
+
+    int64_t elapsed_ms = MAX(k_uptime_get() - stats.since, 1);
+
+    shell_print(shell, "%-25s: %u (%u B/s)", "RTCM3 frames received", stats.frames,
+                (uint32_t)(stats.bytes * 1000ull / elapsed_ms));
+    shell_print(shell, "%-25s: %u", "False preambles", stats.false_preambles);
+    shell_print(shell, "%-25s: %u", "CRC errors", stats.crc_errors);
+    shell_print(shell, "%-25s: %u (%u lost)", "Bytes rescanned for NMEA", stats.rescanned,
+                stats.lost);
+    shell_print(shell, "%-25s: %u", "Dropped (no room)", stats.dropped);
+    shell_print(shell, "%-25s: %u of %u", "Most frames queued", stats.queued_max,
+                CONFIG_LC29H_DEMUX_FRAMES);
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_LC29H_NMEA_GSV
+static int cmd_gnss_sats(const struct shell *shell, size_t argc, char **argv)
+{
+    static struct gnss_sat sats[CONFIG_LC29H_SATS_MAX];
+    uint8_t count = gnss_sats_list(sats, ARRAY_SIZE(sats));
+
+    shell_print(shell, "%-8s %3s %3s %3s  %s", "System", "PRN", "El", "Az", "Signal:SNR");
+    for (uint8_t i = 0; i < count; i++) 
+    {
+        char snr[CONFIG_LC29H_SATS_SIGNALS * 6 + 1];
+        int len = 0;
+
+        for (uint8_t s = 0; s < sats[i].signals; s++) 
+        {
+            len += snprintk(&snr[len], sizeof(snr) - len, " %X:%02u", sats[i].signal[s], sats[i].snr[s]);
+        }
+        shell_print(shell, "%-8s %3u %3d %3u %s", gnss_system_names[sats[i].system],
+                    sats[i].prn, sats[i].elevation, sats[i].azimuth, snr);
+    }
+    shell_print(shell, "%u satellites in view", count);
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_LC29H_TRACK
+static int cmd_gnss_track(const struct shell *shell, size_t argc, char **argv)
+{
+    struct gnss_track_usage usage;
+
+    gnss_track_usage(&usage);
+    shell_print(shell, "%-25s: %u (%u to %u)", "Pages", usage.pages,
+                usage.first_seq, usage.last_seq);
+    shell_print(shell, "%-25s: %u", "Fixes stored", usage.fixes);
+    shell_print(shell, "%-25s: %u of %u", "Bytes used", usage.bytes, usage.capacity);
+    shell_print(shell, "%-25s: %u", "Fixes in RAM", usage.pending);
+    shell_print(shell, "%-25s: %u", "Fixes dropped", usage.dropped);
+    return 0;
+}
+
+static int track_print_fix(const struct gnss_history_fix *fix, void *user_data)
+{
+    const struct shell *shell = user_data;
+
+    shell_print(shell, "%04u-%02u-%02u %02u:%02u:%02u.%03u %.07lf %.07lf %d.%02u",
+                fix->year, fix->month, fix->day, fix->time_ms / 3600000,
+                fix->time_ms / 60000 % 60, fix->time_ms / 1000 % 60, fix->time_ms % 1000,
+                fix->latitude / 1e7, fix->longitude / 1e7,
+                fix->altitude / 100, (uint32_t)abs(fix->altitude % 100));
+    return 0;
+}
+
+static int track_print_page(const uint8_t *page, size_t len, void *user_data)
+{
+    shell_hexdump(user_data, page, len);
+    return 0;
+}
+
+static int cmd_gnss_track_replay(const struct shell *shell, size_t argc, char **argv)
+{
+    return gnss_track_replay(track_print_fix, (void *)shell);
+}
+
+static int cmd_gnss_track_export(const struct shell *shell, size_t argc, char **argv)
+{
+    return gnss_track_export(track_print_page, (void *)shell);
+}
+
+static int cmd_gnss_track_flush(const struct shell *shell, size_t argc, char **argv)
+{
+    return gnss_track_flush();
+}
+
+static int cmd_gnss_track_erase(const struct shell *shell, size_t argc, char **argv)
+{
+    return gnss_track_erase();
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_gnss_track,
+    SHELL_CMD(replay, NULL, "Print every stored fix", cmd_gnss_track_replay),
+    SHELL_CMD(export, NULL, "Dump the raw pages", cmd_gnss_track_export),
+    SHELL_CMD(flush, NULL, "Commit the fixes held in RAM", cmd_gnss_track_flush),
+    SHELL_CMD(erase, NULL, "Erase the track log partition", cmd_gnss_track_erase),
+    SHELL_SUBCMD_SET_END
+);
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_gnss,
+#ifdef CONFIG_LC29H_CMD
+    SHELL_CMD_ARG(cmd, NULL, "Send a command and wait for its answer (<body> [query])",
+                  cmd_gnss_cmd, 2, 1),
+#endif
+#ifdef CONFIG_LC29H_BAUD
+    SHELL_CMD_ARG(baud, NULL, "Show or switch the UART baud rate ([<rate>|detect])",
+                  cmd_gnss_baud, 1, 1),
+#endif
+#ifdef CONFIG_LC29H_GOVERNOR
+    SHELL_CMD(governor, NULL, "Show the output rate governor", cmd_gnss_governor),
+#endif
+#ifdef CONFIG_LC29H_RTCM
+    SHELL_CMD_ARG(rtcm, NULL, "Show RTCM3 correction statistics ([reset])", cmd_gnss_rtcm, 1, 1),
+#endif
+#ifdef CONFIG_LC29H_DEMUX
+    SHELL_CMD_ARG(demux, NULL, "Show received RTCM3 statistics ([reset])", cmd_gnss_demux, 1, 1),
+#endif
+#ifdef CONFIG_LC29H_CONFIG
+    SHELL_CMD(config, NULL, "Apply the receiver profile of this build", cmd_gnss_config),
+#endif
+#ifdef CONFIG_LC29H_NMEA_GSV
+    SHELL_CMD(sats, NULL, "Show the satellites in view", cmd_gnss_sats),
+#endif
+#ifdef CONFIG_LC29H_STATS
+    SHELL_CMD_ARG(stats, NULL, "Show receive statistics ([reset])", cmd_gnss_stats, 1, 1),
+#endif
+#ifdef CONFIG_LC29H_HISTORY
+    SHELL_CMD_ARG(history, NULL, "Show stored fixes ([dump|clear])", cmd_gnss_history, 1, 1),
+#endif
+#ifdef CONFIG_LC29H_TRACK
+    SHELL_CMD(track, &sub_gnss_track, "Flash track log", cmd_gnss_track),
+#endif
+    SHELL_SUBCMD_SET_END
+);
+
 /* Shell command registration */
 SHELL_CMD_REGISTER(swversion, NULL, "Request software version from LH29C", cmd_swversion);
 SHELL_CMD_REGISTER(show_swversion, NULL, "Software version is", cmd_show_swversion);
-SHELL_CMD_ARG_REGISTER(send_nmea, NULL, "Send custom NMEA command to LH29C (include $ and *CRC)", cmd_send_nmea, 2, 0);
+SHELL_CMD_ARG_REGISTER(send_nmea, NULL, "Send custom NMEA command to LH29C ($ optional, no checksum)", cmd_send_nmea, 2, 0);
 SHELL_CMD_REGISTER(read_nmea, NULL, "Request the GPS data from LH29C", cmd_read_nmea);
+SHELL_CMD_REGISTER(gnss, &sub_gnss, "GNSS receiver commands", NULL);
+#ifdef CONFIG_LC29H_RX_PROFILE
+SHELL_CMD_ARG_REGISTER(rx_profile, NULL, "Show receive path profile ([reset])", cmd_rx_profile, 1, 1);
+#endif
 
 void print_banner_char(char ch, int row) 
 {